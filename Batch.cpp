@@ -0,0 +1,232 @@
+#include "Batch.hpp"
+
+#include <cstdio>
+
+namespace def
+{
+	void FormatResult(const std::optional<Object>& result, std::string& output)
+	{
+		if (!result)
+			return;
+
+		std::visit([&](const auto& arg)
+			{
+				using T = std::decay_t<decltype(arg)>;
+
+				// Same as the default formatting of streams
+				char buffer[64];
+
+				if constexpr (std::is_same_v<T, Array>)
+				{
+					output += '[';
+
+					for (size_t i = 0; i < arg.value.size(); i++)
+					{
+						std::snprintf(buffer, sizeof(buffer), "%g", arg.value[i]);
+
+						output += i > 0 ? ", " : "";
+						output += buffer;
+					}
+
+					output += ']';
+				}
+				else if constexpr (std::is_same_v<T, Numeric>)
+				{
+					std::snprintf(buffer, sizeof(buffer), "%Lg", arg.value);
+					output += buffer;
+				}
+				else if constexpr (std::is_same_v<T, Boolean>)
+					output += arg.value ? "true" : "false";
+				else if constexpr (std::is_same_v<T, Reference>)
+					FormatResult(*arg.value, output);
+				else
+					output += arg.value;
+			}, result.value());
+	}
+
+	BatchRunner::BatchRunner(size_t lanes)
+	{
+		for (size_t i = 0; i < std::max<size_t>(lanes, 1); i++)
+			m_Lanes.push_back(std::make_unique<Lane>());
+	}
+
+	void BatchRunner::Run(std::istream& input, std::ostream& output)
+	{
+		std::vector<std::thread> threads;
+
+		for (auto& lane : m_Lanes)
+		{
+			threads.emplace_back(&BatchRunner::Compile, this, std::ref(*lane));
+			threads.emplace_back(&BatchRunner::Evaluate, this, std::ref(*lane));
+		}
+
+		threads.emplace_back(&BatchRunner::Write, this, std::ref(output));
+
+		Read(input);
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	void BatchRunner::Read(std::istream& input)
+	{
+		std::string carry;
+		size_t lane = 0;
+
+		for (bool end = false; !end;)
+		{
+			auto block = std::make_unique<Block>();
+			block->text = std::move(carry);
+
+			const size_t size = block->text.size();
+
+			block->text.resize(size + BLOCK_SIZE);
+			input.read(block->text.data() + size, BLOCK_SIZE);
+			block->text.resize(size + input.gcount());
+
+			end = !input;
+
+			if (!end)
+			{
+				// The incomplete last line goes to the next block
+				const size_t newline = block->text.rfind('\n');
+
+				if (newline == std::string::npos)
+				{
+					carry = std::move(block->text);
+					continue;
+				}
+
+				carry.assign(block->text, newline + 1);
+				block->text.resize(newline + 1);
+			}
+			else
+				carry.clear();
+
+			std::string_view text = block->text;
+
+			while (!text.empty())
+			{
+				const size_t newline = text.find('\n');
+				block->records.push_back(text.substr(0, newline));
+
+				if (newline == std::string_view::npos)
+					break;
+
+				text.remove_prefix(newline + 1);
+			}
+
+			m_Lanes[lane]->source.Push(std::move(block));
+			lane = (lane + 1) % m_Lanes.size();
+		}
+
+		// The writer meets the first marker right after the last block,
+		// the rest of them only stop the lanes
+		for (size_t i = 0; i < m_Lanes.size(); i++)
+		{
+			auto block = std::make_unique<Block>();
+			block->last = true;
+
+			m_Lanes[(lane + i) % m_Lanes.size()]->source.Push(std::move(block));
+		}
+	}
+
+	void BatchRunner::Compile(Lane& lane)
+	{
+		Parser parser;
+		Compiler compiler;
+
+		std::vector<Token> tokens;
+
+		for (bool last = false; !last;)
+		{
+			auto block = lane.source.Pop();
+			last = block->last;
+
+			const size_t count = block->records.size();
+
+			block->programs.resize(count);
+			block->errors.resize(count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				try
+				{
+					tokens.clear();
+					parser.Tokenise(ProgramCache::Normalise(block->records[i]), tokens);
+
+					compiler.Compile(tokens, block->programs[i]);
+				}
+				catch (const std::exception& e)
+				{
+					// Standard exceptions (e.g. std::bad_alloc) fail only their record, the lane keeps going
+					block->errors[i] = e.what();
+				}
+				catch (...)
+				{
+					block->errors[i] = "Unknown error";
+				}
+			}
+
+			lane.compiled.Push(std::move(block));
+		}
+	}
+
+	void BatchRunner::Evaluate(Lane& lane)
+	{
+		Interpreter interpreter;
+
+		for (bool last = false; !last;)
+		{
+			auto block = lane.compiled.Pop();
+			last = block->last;
+
+			for (size_t i = 0; i < block->programs.size(); i++)
+			{
+				if (!block->errors[i].empty())
+					block->output += block->errors[i];
+				else
+				{
+					try
+					{
+						FormatResult(interpreter.Execute(block->programs[i]), block->output);
+					}
+					catch (const std::exception& e)
+					{
+						block->output += e.what();
+					}
+					catch (...)
+					{
+						block->output += "Unknown error";
+					}
+				}
+
+				block->output += '\n';
+
+				// Records are independent so nothing is carried over to the next one
+				interpreter.Reset();
+			}
+
+			// Only the output is needed from now on
+			block->programs.clear();
+			block->errors.clear();
+
+			lane.evaluated.Push(std::move(block));
+		}
+	}
+
+	void BatchRunner::Write(std::ostream& output)
+	{
+		for (size_t lane = 0;; lane = (lane + 1) % m_Lanes.size())
+		{
+			auto block = m_Lanes[lane]->evaluated.Pop();
+
+			if (block->last)
+				break;
+
+			output.write(block->output.data(), block->output.size());
+		}
+
+		output.flush();
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Interpreter.hpp"
+#include "Queue.hpp"
+
+namespace def
+{
+	// Appends the value the same way the REPL prints it, nothing for an empty result
+	void FormatResult(const std::optional<Object>& result, std::string& output);
+
+	// Evaluates a stream of independent newline-delimited records and writes one line per record
+	// (the result, an empty line or the error) in the input order.
+	// The reader splits the input into blocks of lines and deals them to lanes in turn,
+	// every lane is a tokenising/compiling thread feeding an evaluating thread,
+	// the writer collects blocks from the lanes in the same order so no reordering is needed
+	class BatchRunner
+	{
+	public:
+		BatchRunner(size_t lanes = std::max(1u, std::thread::hardware_concurrency() / 2));
+
+	public:
+		void Run(std::istream& input, std::ostream& output);
+
+	private:
+		struct Block
+		{
+			// Complete lines of the input, records point into it
+			std::string text;
+			std::vector<std::string_view> records;
+
+			// A program or an error for every record
+			std::vector<Program> programs;
+			std::vector<std::string> errors;
+
+			std::string output;
+
+			// Tells the lane and the writer that the input is over
+			bool last = false;
+		};
+
+		struct Lane
+		{
+			SpscQueue<std::unique_ptr<Block>> source;
+			SpscQueue<std::unique_ptr<Block>> compiled;
+			SpscQueue<std::unique_ptr<Block>> evaluated;
+		};
+
+	private:
+		void Read(std::istream& input);
+		void Compile(Lane& lane);
+		void Evaluate(Lane& lane);
+		void Write(std::ostream& output);
+
+	private:
+		std::vector<std::unique_ptr<Lane>> m_Lanes;
+
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	};
+}
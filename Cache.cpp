@@ -0,0 +1,112 @@
+#include "Cache.hpp"
+#include "Guard.hpp"
+
+namespace def
+{
+	ProgramCache::ProgramCache(size_t capacity) : m_Capacity(capacity)
+	{
+		m_Lookup.reserve(capacity);
+	}
+
+	std::shared_ptr<const Program> ProgramCache::Get(std::string_view source)
+	{
+		source = Normalise(source);
+
+		std::lock_guard lock(m_Mutex);
+
+		auto it = m_Lookup.find(source);
+
+		if (it == m_Lookup.end())
+		{
+			m_Statistics.misses++;
+			return nullptr;
+		}
+
+		// Move the entry to the front so it's evicted last
+		m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+		m_Statistics.hits++;
+
+		return it->second->second;
+	}
+
+	void ProgramCache::Put(std::string_view source, std::shared_ptr<const Program> program)
+	{
+		source = Normalise(source);
+
+		std::lock_guard lock(m_Mutex);
+
+		if (m_Capacity == 0)
+			return;
+
+		auto it = m_Lookup.find(source);
+
+		if (it != m_Lookup.end())
+		{
+			// Another thread could have compiled the same source, so just refresh the entry
+			it->second->second = std::move(program);
+			m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+			return;
+		}
+
+		m_Entries.emplace_front(std::string(source), std::move(program));
+		m_Lookup.emplace(m_Entries.front().first, m_Entries.begin());
+
+		Evict();
+	}
+
+	void ProgramCache::SetCapacity(size_t capacity)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		m_Capacity = capacity;
+		Evict();
+	}
+
+	size_t ProgramCache::GetCapacity() const
+	{
+		std::lock_guard lock(m_Mutex);
+		return m_Capacity;
+	}
+
+	ProgramCache::Statistics ProgramCache::GetStatistics() const
+	{
+		std::lock_guard lock(m_Mutex);
+
+		Statistics statistics = m_Statistics;
+		statistics.size = m_Entries.size();
+
+		return statistics;
+	}
+
+	void ProgramCache::Clear()
+	{
+		std::lock_guard lock(m_Mutex);
+
+		m_Lookup.clear();
+		m_Entries.clear();
+	}
+
+	std::string_view ProgramCache::Normalise(std::string_view source)
+	{
+		while (!source.empty() && guard::Whitespaces[(unsigned char)source.front()])
+			source.remove_prefix(1);
+
+		while (!source.empty() && guard::Whitespaces[(unsigned char)source.back()])
+			source.remove_suffix(1);
+
+		return source;
+	}
+
+	void ProgramCache::Evict()
+	{
+		// Must be called with the mutex locked
+
+		while (m_Entries.size() > m_Capacity)
+		{
+			m_Lookup.erase(m_Entries.back().first);
+			m_Entries.pop_back();
+
+			m_Statistics.evictions++;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Program.hpp"
+
+namespace def
+{
+	// Bounded LRU cache from source text to the compiled program,
+	// all methods are thread-safe so one cache can be shared between interpreters
+	class ProgramCache
+	{
+	public:
+		struct Statistics
+		{
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t evictions = 0;
+			size_t size = 0;
+		};
+
+	public:
+		ProgramCache(size_t capacity = 1024);
+
+	public:
+		// Returns nullptr if there is no program for the given source
+		std::shared_ptr<const Program> Get(std::string_view source);
+
+		void Put(std::string_view source, std::shared_ptr<const Program> program);
+
+		void SetCapacity(size_t capacity);
+		size_t GetCapacity() const;
+
+		Statistics GetStatistics() const;
+
+		void Clear();
+
+		// Strips leading and trailing whitespaces so "a + 1" and " a + 1 " share an entry
+		static std::string_view Normalise(std::string_view source);
+
+	private:
+		void Evict();
+
+	private:
+		using Entry = std::pair<std::string, std::shared_ptr<const Program>>;
+
+		mutable std::mutex m_Mutex;
+
+		size_t m_Capacity;
+
+		// The most recently used entries are at the front
+		std::list<Entry> m_Entries;
+
+		// Keys point to the strings stored in m_Entries so a lookup doesn't allocate
+		std::unordered_map<std::string_view, std::list<Entry>::iterator> m_Lookup;
+
+		Statistics m_Statistics;
+
+	};
+}
@@ -0,0 +1,463 @@
+#include "Compiler.hpp"
+
+#include <deque>
+#include <list>
+#include <algorithm>
+
+namespace def
+{
+	Compiler::Compiler()
+	{
+	}
+
+	void Compiler::Compile(const std::vector<Token>& tokens, Program& program)
+	{
+		m_SymbolIndices.clear();
+		m_Parameters.clear();
+
+		// Statements are separated with semicolons and
+		// the result of every statement except the last one is discarded
+
+		auto begin = tokens.begin();
+
+		for (auto it = tokens.begin(); it != tokens.end(); it++)
+		{
+			if (it->type == Token::Type::Semicolon)
+			{
+				CompileStatement({ begin, it }, program);
+				Emit(*it, program);
+
+				begin = it + 1;
+			}
+		}
+
+		CompileStatement({ begin, tokens.end() }, program);
+
+		if (m_Optimise)
+			Optimiser::Optimise(program);
+	}
+
+	void Compiler::SetOptimisation(bool enabled)
+	{
+		m_Optimise = enabled;
+	}
+
+	void Compiler::CompileStatement(std::span<const Token> tokens, Program& program)
+	{
+		if (IsDefinition(tokens))
+			CompileFunction(tokens, program);
+		else
+			CompileExpression(tokens, program);
+	}
+
+	bool Compiler::IsDefinition(std::span<const Token> tokens)
+	{
+		// name(a, b, ...) = body
+
+		if (tokens.size() < 5 || tokens[0].type != Token::Type::Symbol || tokens[1].value != "(")
+			return false;
+
+		size_t i = 2;
+
+		if (tokens[i].type != Token::Type::Parenthesis_Close)
+		{
+			while (i < tokens.size() && tokens[i].type == Token::Type::Symbol)
+			{
+				i++;
+
+				if (i < tokens.size() && tokens[i].type == Token::Type::Comma)
+					i++;
+				else
+					break;
+			}
+		}
+
+		return i + 2 < tokens.size() &&
+			tokens[i].value == ")" &&
+			tokens[i + 1].type == Token::Type::Operator &&
+			tokens[i + 1].value == "=";
+	}
+
+	void Compiler::CompileFunction(std::span<const Token> tokens, Program& program)
+	{
+		Function function;
+		function.name = tokens[0].value;
+
+		std::vector<std::string> parameters;
+
+		size_t i = 2;
+
+		for (; tokens[i].type != Token::Type::Parenthesis_Close; i++)
+		{
+			if (tokens[i].type != Token::Type::Symbol)
+				continue;
+
+			if (std::find(parameters.begin(), parameters.end(), tokens[i].value) != parameters.end())
+				throw ParserException("Duplicate parameter " + tokens[i].value + " of the function " + function.name);
+
+			parameters.push_back(tokens[i].value);
+		}
+
+		// The body is a separate program with its own symbols,
+		// parameters are turned into indices of local slots of the call frame
+
+		auto body = std::make_shared<Program>();
+
+		auto outerSymbols = std::move(m_SymbolIndices);
+		auto outerParameters = std::move(m_Parameters);
+
+		m_SymbolIndices.clear();
+		m_Parameters = parameters;
+
+		CompileExpression(tokens.subspan(i + 2), *body);
+		Emit({ Instruction::Type::Return }, tokens.back().offset, *body);
+
+		if (m_Optimise)
+			Optimiser::Optimise(*body);
+
+		m_SymbolIndices = std::move(outerSymbols);
+		m_Parameters = std::move(outerParameters);
+
+		function.arity = uint32_t(parameters.size());
+		function.body = std::move(body);
+
+		program.functions.push_back(std::move(function));
+		Emit({ Instruction::Type::Define, uint32_t(program.functions.size() - 1) }, tokens[0].offset, program);
+	}
+
+	void Compiler::CompileExpression(std::span<const Token> tokens, Program& program)
+	{
+		// It uses Shunting yard algorithm
+
+		std::deque<Token> holding;
+
+		// Every open parenthesis starts a group: a plain grouping, an array literal,
+		// an index of the previous value, arguments of a function call or branches of a condition
+		struct Group
+		{
+			enum class Type
+			{
+				Parenthesis,
+				Array,
+				Index,
+				Call,
+				Condition
+			} type;
+
+			// Number of commas inside the group
+			uint32_t commas;
+
+			// A jump of the condition that must be pointed to the next branch
+			size_t jump;
+		};
+
+		std::vector<Group> groups;
+
+		Token prev(Token::Type::None);
+
+		for (size_t i = 0; i < tokens.size(); i++)
+		{
+			auto token = tokens[i];
+
+			switch (token.type)
+			{
+			case Token::Type::Literal_NumericBase10:
+			case Token::Type::Literal_NumericBase16:
+			case Token::Type::Literal_NumericBase8:
+			case Token::Type::Literal_NumericBase2:
+			case Token::Type::Literal_String:
+			case Token::Type::Literal_Boolean:
+			case Token::Type::Symbol:
+				Emit(token, program);
+				break;
+
+			case Token::Type::Keyword:
+			{
+				if (Parser::s_Keywords.at(token.value).type == Keyword::Type::If)
+				{
+					// The condition is compiled into jumps when its parenthesis is opened
+					if (i + 1 == tokens.size() || tokens[i + 1].value != "(")
+						throw ParserException("Expected if(condition, then, else)");
+				}
+				else
+					Emit(token, program);
+			}
+			break;
+
+			case Token::Type::Operator:
+			{
+				const Operator& op = Parser::s_Operators.at(token.value);
+
+				// Check for an unary operator
+				if (token.value == "+" || token.value == "-")
+				{
+					std::list<Token::Type> excluded =
+					{
+						Token::Type::Literal_NumericBase16,
+						Token::Type::Literal_NumericBase10,
+						Token::Type::Literal_NumericBase8,
+						Token::Type::Literal_NumericBase2,
+						Token::Type::Literal_String,
+						Token::Type::Symbol,
+						Token::Type::Parenthesis_Close
+					};
+
+					bool notExcluded = std::find(excluded.begin(), excluded.end(), prev.type) == excluded.end();
+
+					if (notExcluded || prev.type == Token::Type::None)
+						token.value = "u" + token.value;
+				}
+
+				// Drain the stack out to the output until there's nothing to take or
+				// the precedence of the current token is less than the precedence of the top-stack token
+				while (!holding.empty() && holding.back().type != Token::Type::Parenthesis_Open && op.precedence <= Parser::s_Operators.at(holding.back().value).precedence)
+				{
+					Emit(holding.back(), program);
+					holding.pop_back();
+				}
+
+				// only then append current token to the holding stack
+				holding.push_back(token);
+			}
+			break;
+
+			case Token::Type::Parenthesis_Open:
+			{
+				Group group{ Group::Type::Parenthesis, 0, 0 };
+
+				if (token.value == "[")
+				{
+					std::list<Token::Type> values =
+					{
+						Token::Type::Literal_NumericBase16,
+						Token::Type::Literal_NumericBase10,
+						Token::Type::Literal_NumericBase8,
+						Token::Type::Literal_NumericBase2,
+						Token::Type::Literal_String,
+						Token::Type::Symbol,
+						Token::Type::Parenthesis_Close
+					};
+
+					bool index = std::find(values.begin(), values.end(), prev.type) != values.end();
+
+					group.type = index ? Group::Type::Index : Group::Type::Array;
+				}
+				else if (token.value == "(" && prev.type == Token::Type::Symbol)
+				{
+					// The symbol is already emitted so the callee is right below the arguments
+					group.type = Group::Type::Call;
+				}
+				else if (token.value == "(" && prev.type == Token::Type::Keyword && Parser::s_Keywords.at(prev.value).type == Keyword::Type::If)
+					group.type = Group::Type::Condition;
+
+				groups.push_back(group);
+				holding.push_back(token);
+			}
+			break;
+
+			case Token::Type::Parenthesis_Close:
+			{
+				// Drain the holding stack out until an open parenthesis
+				while (holding.back().type != Token::Type::Parenthesis_Open)
+				{
+					Emit(holding.back(), program);
+					holding.pop_back();
+				}
+
+				// And remove the parenthesis by itself
+				holding.pop_back();
+
+				if (!groups.empty())
+				{
+					const Group group = groups.back();
+					groups.pop_back();
+
+					// The last element isn't followed by a comma, unless the group is empty
+					const bool last = prev.type != Token::Type::Parenthesis_Open && prev.type != Token::Type::Comma;
+					const uint32_t elements = group.commas + (last ? 1 : 0);
+
+					switch (group.type)
+					{
+					case Group::Type::Array: Emit({ Instruction::Type::MakeArray, elements }, token.offset, program); break;
+					case Group::Type::Index: Emit({ Instruction::Type::Index }, token.offset, program); break;
+					case Group::Type::Call:  Emit({ Instruction::Type::Call, elements }, token.offset, program); break;
+
+					case Group::Type::Condition:
+					{
+						if (group.commas != 2)
+							throw ParserException("Expected if(condition, then, else)");
+
+						// Skip the else branch after the then branch
+						program.instructions[group.jump].operand = uint32_t(program.instructions.size());
+					}
+					break;
+					}
+				}
+			}
+			break;
+
+			case Token::Type::Comma:
+			{
+				// Finish the current element
+				while (!holding.empty() && holding.back().type != Token::Type::Parenthesis_Open)
+				{
+					Emit(holding.back(), program);
+					holding.pop_back();
+				}
+
+				if (groups.empty())
+					break;
+
+				Group& group = groups.back();
+				group.commas++;
+
+				if (group.type == Group::Type::Condition)
+				{
+					if (group.commas == 1)
+					{
+						// Go to the else branch if the condition is false
+						group.jump = program.instructions.size();
+						Emit({ Instruction::Type::JumpIfFalse }, token.offset, program);
+					}
+					else if (group.commas == 2)
+					{
+						const size_t jumpToElse = group.jump;
+
+						// The then branch is over so jump past the else branch
+						group.jump = program.instructions.size();
+						Emit({ Instruction::Type::Jump }, token.offset, program);
+
+						program.instructions[jumpToElse].operand = uint32_t(program.instructions.size());
+					}
+				}
+			}
+			break;
+
+			}
+
+			prev = token;
+		}
+
+		// Drain out the holding stack at the end
+		while (!holding.empty())
+		{
+			Emit(holding.back(), program);
+			holding.pop_back();
+		}
+	}
+
+	void Compiler::Emit(const Token& token, Program& program)
+	{
+		Instruction instruction;
+
+		switch (token.type)
+		{
+		case Token::Type::Literal_NumericBase10:
+		case Token::Type::Literal_NumericBase16:
+		case Token::Type::Literal_NumericBase8:
+		case Token::Type::Literal_NumericBase2:
+		case Token::Type::Literal_String:
+		case Token::Type::Literal_Boolean:
+		{
+			// Literals are decoded only once and stored in the constant pool
+			switch (token.type)
+			{
+			case Token::Type::Literal_NumericBase10:
+			case Token::Type::Literal_NumericBase16:
+			case Token::Type::Literal_NumericBase8:
+			case Token::Type::Literal_NumericBase2:  program.constants.push_back(Numeric{ token.number }); break;
+			case Token::Type::Literal_String:        program.constants.push_back(String{ token.value }); break;
+			case Token::Type::Literal_Boolean:       program.constants.push_back(Boolean{ token.value == "true" }); break;
+			}
+
+			instruction.type = Instruction::Type::PushConstant;
+			instruction.operand = uint32_t(program.constants.size() - 1);
+		}
+		break;
+
+		case Token::Type::Symbol:
+		{
+			// Parameters of the function being compiled live in the call frame
+			const auto parameter = std::find(m_Parameters.begin(), m_Parameters.end(), token.value);
+
+			if (parameter != m_Parameters.end())
+			{
+				instruction.type = Instruction::Type::PushLocal;
+				instruction.operand = uint32_t(parameter - m_Parameters.begin());
+			}
+			else
+			{
+				instruction.type = Instruction::Type::PushSymbol;
+				instruction.operand = AddSymbol(token.value, program);
+			}
+		}
+		break;
+
+		case Token::Type::Keyword:
+		{
+			switch (Parser::s_Keywords.at(token.value).type)
+			{
+			case Keyword::Type::While: instruction.type = Instruction::Type::While; break;
+			case Keyword::Type::For:   instruction.type = Instruction::Type::For;   break;
+			default: return;
+			}
+		}
+		break;
+
+		case Token::Type::Operator:
+		{
+			const auto& op = Parser::s_Operators.at(token.value);
+
+			if (op.arguments == 1)
+			{
+				switch (op.type)
+				{
+				case Operator::Type::Subtraction: instruction.type = Instruction::Type::UnaryMinus; break;
+				case Operator::Type::Addition:    instruction.type = Instruction::Type::UnaryPlus;  break;
+				case Operator::Type::Length:      instruction.type = Instruction::Type::Length;     break;
+				}
+			}
+			else
+			{
+				switch (op.type)
+				{
+				case Operator::Type::Subtraction:    instruction.type = Instruction::Type::Subtraction;    break;
+				case Operator::Type::Addition:       instruction.type = Instruction::Type::Addition;       break;
+				case Operator::Type::Multiplication: instruction.type = Instruction::Type::Multiplication; break;
+				case Operator::Type::Division:       instruction.type = Instruction::Type::Division;       break;
+				case Operator::Type::Equals:         instruction.type = Instruction::Type::Equals;         break;
+				case Operator::Type::Assign:         instruction.type = Instruction::Type::Assign;         break;
+				}
+			}
+		}
+		break;
+
+		case Token::Type::Semicolon:
+			instruction.type = Instruction::Type::Pop;
+		break;
+
+		default:
+			// Commas and parentheses don't produce any instructions by themselves
+			return;
+
+		}
+
+		Emit(instruction, token.offset, program);
+	}
+
+	void Compiler::Emit(const Instruction& instruction, size_t offset, Program& program)
+	{
+		program.instructions.push_back(instruction);
+		program.offsets.push_back(uint32_t(offset));
+	}
+
+	uint32_t Compiler::AddSymbol(const std::string& name, Program& program)
+	{
+		auto [it, inserted] = m_SymbolIndices.try_emplace(name, uint32_t(program.symbols.size()));
+
+		if (inserted)
+			program.symbols.push_back(Symbol{ name });
+
+		return it->second;
+	}
+}
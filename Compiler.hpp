@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <span>
+
+#include "Parser.hpp"
+#include "Program.hpp"
+#include "Optimiser.hpp"
+#include "Token.hpp"
+
+namespace def
+{
+	class Compiler
+	{
+	public:
+		Compiler();
+
+	public:
+		// Converts tokens from the infix notation into a flat sequence of instructions
+		void Compile(const std::vector<Token>& tokens, Program& program);
+
+		// Superinstructions are produced by default, disabling them helps to compare dispatch counts
+		void SetOptimisation(bool enabled);
+
+	private:
+		void CompileStatement(std::span<const Token> tokens, Program& program);
+		void CompileFunction(std::span<const Token> tokens, Program& program);
+		void CompileExpression(std::span<const Token> tokens, Program& program);
+
+		static bool IsDefinition(std::span<const Token> tokens);
+
+		void Emit(const Token& token, Program& program);
+		void Emit(const Instruction& instruction, size_t offset, Program& program);
+
+		uint32_t AddSymbol(const std::string& name, Program& program);
+
+	private:
+		// Used to avoid storing the same symbol twice in a program
+		std::unordered_map<std::string, uint32_t> m_SymbolIndices;
+
+		// Parameters of the function whose body is being compiled
+		std::vector<std::string> m_Parameters;
+
+		bool m_Optimise = true;
+
+	};
+}
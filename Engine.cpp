@@ -0,0 +1,19 @@
+#include "Engine.hpp"
+
+namespace def
+{
+	Engine::Engine(size_t cacheCapacity)
+	{
+		m_Interpreter.SetCache(std::make_shared<ProgramCache>(cacheCapacity));
+	}
+
+	std::optional<Object> Engine::Evaluate(std::string_view source)
+	{
+		return m_Interpreter.Evaluate(source);
+	}
+
+	Interpreter& Engine::GetInterpreter()
+	{
+		return m_Interpreter;
+	}
+}
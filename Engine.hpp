@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Interpreter.hpp"
+
+namespace def
+{
+	namespace native
+	{
+		// Deduces the signature of a function pointer or a lambda
+		template <class F>
+		struct Signature : Signature<decltype(&F::operator())> {};
+
+		template <class R, class... Args>
+		struct Signature<R(*)(Args...)>
+		{
+			using Return = R;
+			using Arguments = std::tuple<Args...>;
+		};
+
+		template <class C, class R, class... Args>
+		struct Signature<R(C::*)(Args...) const> : Signature<R(*)(Args...)> {};
+
+		template <class C, class R, class... Args>
+		struct Signature<R(C::*)(Args...)> : Signature<R(*)(Args...)> {};
+
+		// Strings and arrays are returned by reference so they are not copied
+		template <class T>
+		decltype(auto) FromObject(const Object& object, const std::string& function, size_t index)
+		{
+			using U = std::remove_cvref_t<T>;
+
+			auto check = [&]<class V>(const char* type)
+				{
+					if (!std::holds_alternative<V>(object))
+						throw InterpreterException("Argument " + std::to_string(index + 1) + " of " + function + " must be " + type);
+				};
+
+			if constexpr (std::is_same_v<U, bool>)
+			{
+				check.template operator()<Boolean>("a boolean");
+				return std::get<Boolean>(object).value;
+			}
+			else if constexpr (std::is_arithmetic_v<U>)
+			{
+				check.template operator()<Numeric>("a number");
+				return U(std::get<Numeric>(object).value);
+			}
+			else if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>)
+			{
+				check.template operator()<String>("a string");
+				return (std::get<String>(object).value);
+			}
+			else if constexpr (std::is_same_v<U, std::vector<double>>)
+			{
+				check.template operator()<Array>("an array");
+				return (std::get<Array>(object).value);
+			}
+			else if constexpr (std::is_same_v<U, Object>)
+				return (object);
+			else
+				static_assert(!sizeof(U), "Unsupported argument type of the native function");
+		}
+
+		template <class T>
+		Object ToObject(T&& value)
+		{
+			using U = std::remove_cvref_t<T>;
+
+			if constexpr (std::is_same_v<U, bool>)
+				return Boolean{ value };
+			else if constexpr (std::is_arithmetic_v<U>)
+				return Numeric{ (long double)value };
+			else if constexpr (std::is_same_v<U, std::string_view>)
+				return String{ std::string(value) };
+			else if constexpr (std::is_same_v<U, std::string>)
+				return String{ std::forward<T>(value) };
+			else if constexpr (std::is_same_v<U, std::vector<double>>)
+				return Array{ std::forward<T>(value) };
+			else if constexpr (std::is_same_v<U, Object>)
+				return std::forward<T>(value);
+			else
+				static_assert(!sizeof(U), "Unsupported return type of the native function");
+		}
+	}
+
+	// Facade for embedding the language into a C++ application
+	class Engine
+	{
+	public:
+		Engine(size_t cacheCapacity = 1024);
+
+	public:
+		std::optional<Object> Evaluate(std::string_view source);
+
+		// Registers a function pointer or a lambda, arguments are converted right from the values
+		// on the stack according to the signature (numbers, bool, strings, std::vector<double>, Object)
+		template <class F>
+		void Register(const std::string& name, F function)
+		{
+			using Arguments = typename native::Signature<std::decay_t<F>>::Arguments;
+			Register(name, std::move(function), (Arguments*)nullptr);
+		}
+
+		// Scripts read and write the variable directly, it must outlive the engine
+		template <class T>
+		void Bind(const std::string& name, T& variable)
+		{
+			m_Interpreter.Bind(name, &variable);
+		}
+
+		Interpreter& GetInterpreter();
+
+	private:
+		template <class F, class... Args>
+		void Register(const std::string& name, F function, std::tuple<Args...>*)
+		{
+			m_Interpreter.RegisterNative(name, sizeof...(Args),
+				[name, function = std::move(function)](const Object* const* arguments) mutable -> Object
+				{
+					return Invoke(name, function, arguments, (std::tuple<Args...>*)nullptr, std::index_sequence_for<Args...>{});
+				});
+		}
+
+		template <class F, class... Args, size_t... I>
+		static Object Invoke(const std::string& name, F& function, const Object* const* arguments, std::tuple<Args...>*, std::index_sequence<I...>)
+		{
+			return native::ToObject(function(native::FromObject<Args>(*arguments[I], name, I)...));
+		}
+
+	private:
+		Interpreter m_Interpreter;
+
+	};
+}
@@ -18,13 +18,16 @@ namespace def
 		}
 
 		constexpr auto Digits = Create(".0123456789");
+		constexpr auto DecDigits = Create("0123456789");
 		constexpr auto HexDigits = Create("0123456789ABCDEFabcdef");
 		constexpr auto OctDigits = Create("01234567");
 		constexpr auto BinDigits = Create("01");
-		constexpr auto Prefixes = Create("xob");
+		constexpr auto Prefixes = Create("xobXOB");
 		constexpr auto Whitespaces = Create(" \t\n\r\v");
+		constexpr auto Exponents = Create("eE");
+		constexpr auto Signs = Create("+-");
 		constexpr auto Symbols = Create("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM0123456789_.");
-		constexpr auto Operators = Create("+-*/=");
+		constexpr auto Operators = Create("+-*/=#");
 		constexpr auto ParenthesesOpen = Create("([{");
 		constexpr auto ParenthesesClose = Create(")]}");
 		constexpr auto Quotes = Create("'\"");
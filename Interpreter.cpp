@@ -1,320 +1,1162 @@
 #include "Interpreter.hpp"
+#include "Kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
 
 namespace def
 {
+	Continuation::Continuation(const Program& program) : program(&program)
+	{
+		// Most expressions never need a deeper stack so it isn't reallocated while they run
+		stack.reserve(16);
+	}
+
+	bool Continuation::IsFinished() const
+	{
+		return frames.empty() && pointer == program->instructions.size();
+	}
+
 	Interpreter::Interpreter()
 	{
+		m_GlobalScope.SetTracker(&m_Memory);
 	}
 
 	std::optional<Object> Interpreter::Solve(const std::vector<Token>& tokens)
 	{
-		// It uses Shunting yard algorithm
+		Program program;
+		m_Compiler.Compile(tokens, program);
+
+		return Execute(program);
+	}
+
+	std::optional<Object> Interpreter::Evaluate(std::string_view source)
+	{
+		std::shared_ptr<const Program> program;
+
+		if (m_Cache)
+			program = m_Cache->Get(source);
+
+		if (!program)
+		{
+			std::vector<Token> tokens;
+			m_Parser.Tokenise(source, tokens);
+
+			auto compiled = std::make_shared<Program>();
+			m_Compiler.Compile(tokens, *compiled);
+
+			program = compiled;
+
+			if (m_Cache)
+				m_Cache->Put(source, program);
+		}
+
+		return Execute(*program);
+	}
+
+	bool Interpreter::SaveSnapshot(const std::string& path) const
+	{
+		return m_GlobalScope.Save(path);
+	}
+
+	bool Interpreter::LoadSnapshot(const std::string& path)
+	{
+		return m_GlobalScope.Load(path);
+	}
+
+	void Interpreter::SetCache(std::shared_ptr<ProgramCache> cache)
+	{
+		m_Cache = std::move(cache);
+	}
+
+	void Interpreter::SetSharedScope(std::shared_ptr<SharedScope> scope)
+	{
+		m_Shared = std::move(scope);
+	}
+
+	std::shared_ptr<SharedScope> Interpreter::GetSharedScope() const
+	{
+		return m_Shared;
+	}
+
+	void Interpreter::SetFallback(const Interpreter* fallback)
+	{
+		m_Fallback = fallback;
+	}
+
+	void Interpreter::Reset()
+	{
+		m_GlobalScope.Clear();
+
+		m_Functions.clear();
+	}
+
+	void Interpreter::SetProfiler(std::shared_ptr<Profiler> profiler)
+	{
+		m_Profiler = std::move(profiler);
+	}
+
+	std::shared_ptr<ProgramCache> Interpreter::GetCache() const
+	{
+		return m_Cache;
+	}
+
+	std::optional<Object> Interpreter::Execute(const Program& program)
+	{
+		Continuation continuation(program);
+		Resume(continuation, Continuation::UNLIMITED);
+
+		return std::move(continuation.result);
+	}
+
+	Continuation Interpreter::Execute(const Program& program, size_t budget)
+	{
+		Continuation continuation(program);
+		Resume(continuation, budget);
+
+		return continuation;
+	}
+
+	bool Interpreter::Resume(Continuation& continuation, size_t budget)
+	{
+		if (m_Shared && !continuation.snapshot)
+			continuation.snapshot = m_Shared->Acquire();
 
-		std::deque<Token> holding, output;
-		std::deque<Object> solving;
+		m_Snapshot = continuation.snapshot.get();
 
-		Token prev(Token::Type::None);
+		try
+		{
+			if (!Run(continuation, budget))
+				return false;
+		}
+		catch (...)
+		{
+			// A failed program can't be resumed so its stack isn't needed anymore,
+			// native functions may also throw standard exceptions
+			Release(continuation);
+			throw;
+		}
+
+		Release(continuation);
+		return true;
+	}
+
+	void Interpreter::SetMemoryLimit(size_t bytes)
+	{
+		m_Memory.SetLimit(bytes);
+	}
+
+	const MemoryTracker& Interpreter::GetMemory() const
+	{
+		return m_Memory;
+	}
+
+	void Interpreter::Release(Continuation& continuation)
+	{
+		for (const auto& object : continuation.stack)
+			m_Memory.Free(MemoryTracker::SizeOf(object));
+
+		continuation.stack.clear();
+		continuation.frames.clear();
+		continuation.body.reset();
 
-		for (auto token : tokens)
+		continuation.snapshot.reset();
+		m_Snapshot = nullptr;
+	}
+
+	bool Interpreter::Run(Continuation& continuation, size_t budget)
+	{
+		auto& solving = continuation.stack;
+
+		auto push = [&](Object&& object) { Push(solving, std::move(object)); };
+		auto pop = [&]() { Pop(solving); };
+
+		for (size_t steps = 0; steps < budget; steps++, continuation.executed++)
 		{
-			switch (token.type)
+			// The program changes on every call and return
+			const Program& program = *continuation.program;
+
+			if (continuation.pointer == program.instructions.size())
+			{
+				if (continuation.frames.empty())
+					break;
+
+				throw InterpreterException("Function finished without returning a value");
+			}
+
+			const auto& instruction = program.instructions[continuation.pointer++];
+
+			if (m_Profiler)
+				m_Profiler->Record(instruction.type);
+
+			switch (instruction.type)
 			{
-			case Token::Type::Literal_NumericBase10:
-			case Token::Type::Literal_NumericBase16:
-			case Token::Type::Literal_NumericBase2:
-			case Token::Type::Literal_String:
-			case Token::Type::Literal_Boolean:
-			case Token::Type::Keyword:
-			case Token::Type::Symbol:
-				output.push_back(token);
+			// Constants and names stay in the program, they are copied only when assigned
+			case Instruction::Type::PushConstant:
+				push(Reference{ &program.constants[instruction.operand] });
+				break;
+
+			case Instruction::Type::PushSymbol:
+				push(Reference{ &program.symbols[instruction.operand] });
 				break;
 
-			case Token::Type::Operator:
+			case Instruction::Type::PushLocal:
+				push(Object(solving[continuation.base + instruction.operand]));
+				break;
+
+			case Instruction::Type::Jump:
+				continuation.pointer = instruction.operand;
+				break;
+
+			case Instruction::Type::JumpIfFalse:
 			{
-				Operator op = Parser::s_Operators[token.value];
+				if (solving.empty())
+					throw InterpreterException("Missing condition");
 
-				// Check for an unary operator
-				if (token.value == "+" || token.value == "-")
-				{
-					std::list<Token::Type> excluded =
-					{
-						Token::Type::Literal_NumericBase16,
-						Token::Type::Literal_NumericBase10,
-						Token::Type::Literal_NumericBase2,
-						Token::Type::Literal_String,
-						Token::Type::Symbol,
-						Token::Type::Parenthesis_Close
-					};
+				const auto& condition = Resolve(solving.back());
 
-					bool notExcluded = std::find(excluded.begin(), excluded.end(), prev.type) == excluded.end();
+				if (!std::holds_alternative<Boolean>(condition))
+					throw InterpreterException("Condition must be a boolean");
 
-					if (notExcluded || prev.type == Token::Type::None)
-						token.value = "u" + token.value;
-				}
+				if (!std::get<Boolean>(condition).value)
+					continuation.pointer = instruction.operand;
 
-				// Drain the stack out to the output stack until there's nothing to take or
-				// the precedence of the current token is less than the precedence of the top-stack token
-				while (!holding.empty() && holding.back().type != Token::Type::Parenthesis_Open && op.precedence <= Parser::s_Operators[holding.back().value].precedence)
-				{
-					output.push_back(holding.back());
-					holding.pop_back();
-				}
+				pop();
+			}
+			break;
 
-				// only then append current token to the holding stack
-				holding.push_back(token);
+			case Instruction::Type::AddConstant:
+			case Instruction::Type::SubtractConstant:
+			case Instruction::Type::MultiplyConstant:
+			case Instruction::Type::DivideConstant:
+				OperateConstant(solving, instruction, program.constants[instruction.operand]);
+				break;
+
+			case Instruction::Type::AssignAddConstant:
+				AssignAddConstant(solving, program.constants[instruction.operand]);
+				break;
+
+			case Instruction::Type::JumpIfNotEqual:
+			{
+				if (!Compare(solving, instruction))
+					continuation.pointer = instruction.operand;
+			}
+			break;
+
+			case Instruction::Type::JumpIfNotEqualConstant:
+			{
+				// Only the target of the JumpIfNotEqual this was fused with is used
+				const size_t target = program.instructions[continuation.pointer++].operand;
+
+				if (!CompareConstant(solving, instruction, program.constants[instruction.operand]))
+					continuation.pointer = target;
 			}
 			break;
 
-			case Token::Type::Parenthesis_Open:
-				holding.push_back(token);
+			case Instruction::Type::Define:
+			{
+				// Suspended frames own the bodies they run so the old one can go right away
+				const auto& function = program.functions[instruction.operand];
+				m_Functions[function.name] = function;
+			}
+			break;
+
+			case Instruction::Type::Return:
+				Return(continuation);
 				break;
 
-			case Token::Type::Parenthesis_Close:
+			case Instruction::Type::Pop:
 			{
-				// Drain the holding stack out until an open parenthesis
-				while (holding.back().type != Token::Type::Parenthesis_Open)
+				// The result of the previous statement isn't used, an empty frame has none
+				if (solving.size() > continuation.base)
+					pop();
+			}
+			break;
+
+			case Instruction::Type::MakeArray:
+			{
+				if (solving.size() < instruction.operand)
+					throw InterpreterException("Not enough elements for the array");
+
+				Array array;
+				array.value.resize(instruction.operand);
+
+				// Elements were pushed in order so the last one is on the top
+				for (size_t i = instruction.operand; i-- > 0;)
 				{
-					output.push_back(holding.back());
-					holding.pop_back();
+					const auto& element = Resolve(solving.back());
+
+					if (!std::holds_alternative<Numeric>(element))
+						throw InterpreterException("Arrays can only hold numeric values");
+
+					array.value[i] = double(std::get<Numeric>(element).value);
+					pop();
 				}
 
-				// And remove the parenthesis by itself
-				holding.pop_back();
+				push(std::move(array));
 			}
 			break;
 
+			case Instruction::Type::Call:
+			{
+				const size_t count = instruction.operand;
+
+				if (solving.size() < count + 1)
+					throw InterpreterException("Not enough arguments for the function call");
+
+				const auto& callee = Dereference(solving[solving.size() - count - 1]);
+
+				if (!std::holds_alternative<Symbol>(callee))
+					throw InterpreterException("Only functions can be called");
+
+				const auto& name = std::get<Symbol>(callee).value;
+
+				// Functions defined by scripts hide native ones
+				const auto function = m_Functions.find(name);
+
+				if (function != m_Functions.end())
+				{
+					Call(continuation, function->second, count);
+					break;
+				}
+
+				const auto native = m_Natives.find(name);
+
+				if (native == m_Natives.end())
+					throw InterpreterException("Unknown function: " + name);
+
+				if (native->second.arity != count)
+					throw InterpreterException("Function " + name + " expects " + std::to_string(native->second.arity) + " arguments");
+
+				// Arguments are passed as pointers to the values on the stack so nothing is copied
+				std::array<const Object*, MAX_NATIVE_ARGUMENTS> arguments;
+
+				for (size_t i = 0; i < count; i++)
+					arguments[i] = &Resolve(solving[solving.size() - count + i]);
+
+				Object result = native->second.function(arguments.data());
+
+				for (size_t i = 0; i <= count; i++)
+					pop();
+
+				push(std::move(result));
 			}
+			break;
+
+			case Instruction::Type::While: ParseWhile(solving); break;
+			case Instruction::Type::For:   ParseFor(solving);   break;
+
+			case Instruction::Type::Subtraction:
+			case Instruction::Type::Addition:
+			case Instruction::Type::Multiplication:
+			case Instruction::Type::Division:
+			case Instruction::Type::Equals:
+				OperateBinary(solving, instruction);
+				break;
 
-			prev = token;
+			default:
+				// Everything else is an operator
+				Operate(solving, instruction.type);
+				break;
+
+			}
 		}
 
-		// Drain out the holding stack at the end
-		while (!holding.empty())
+		if (!continuation.IsFinished())
+			return false;
+
+		// Just for now we only have double as a result
+
+		if (!solving.empty())
 		{
-			output.push_back(holding.back());
-			holding.pop_back();
+			// Return the value of a variable rather than its name
+			const auto& value = Resolve(solving.back());
+
+			// The stack is released right after so a temporary can be moved out of it
+			if (&value != &solving.back())
+				continuation.result = value;
+			else
+				continuation.result = Take(solving.back());
 		}
 
-		putchar('\n');
+		return true;
+	}
+
+	void Interpreter::Operate(std::vector<Object>& solving, Instruction::Type type)
+	{
+		const bool unary =
+			type == Instruction::Type::UnaryMinus ||
+			type == Instruction::Type::UnaryPlus ||
+			type == Instruction::Type::Length;
 
-		for (const auto& token : output)
-			printf("%s\n", token.ToString().c_str());
+		const size_t count = unary ? 1 : 2;
 
-		for (const auto& token : output)
-		{
-			switch (token.type)
+		if (solving.size() < count)
+			throw InterpreterException("Not enough arguments for the operator: " + Instruction{ type }.ToString());
+
+		// Arguments stay on the stack until the result is ready, the first one is on the top
+		auto argument = [&](size_t index) -> Object&
 			{
-			case Token::Type::Literal_NumericBase10: solving.push_back(Numeric{ std::stold(token.value) }); break;
-			case Token::Type::Literal_NumericBase16: solving.push_back(Numeric{ (long double)std::stoll(token.value, nullptr, 16) }); break;
-			case Token::Type::Literal_NumericBase2:  solving.push_back(Numeric{ (long double)std::stoll(token.value, nullptr, 2) }); break;
+				return solving[solving.size() - 1 - index];
+			};
 
-			case Token::Type::Literal_Boolean:
-				solving.push_back(Boolean{ token.value == "true" });
-				break;
+		Object object;
 
-			case Token::Type::Literal_String:
-				solving.push_back(String{ token.value });
-				break;
+#define holds std::holds_alternative
 
-			case Token::Type::Symbol:
-				solving.push_back(Symbol{ token.value });
-				break;
+		auto value_of = [&](size_t index) -> const Object&
+			{
+				return Resolve(argument(index));
+			};
 
-			case Token::Type::Keyword:
+		// Values are borrowed from the stack or the scope, nothing is copied
+		auto unwrap_value = [&]<class T>(size_t index, const std::string& error = "") -> const decltype(T::value)&
 			{
-				const auto& keyword = Parser::s_Keywords[token.value];
+				const auto& value = value_of(index);
 
-				switch (keyword.type)
-				{
-				case Keyword::Type::If: ParseIf(solving); break;
-				case Keyword::Type::While: ParseWhile(solving); break;
-				case Keyword::Type::For: ParseFor(solving); break;
-				}
-			}
-			break;
+				// Couldn't find variable so assume it was an invalid symbol
+				if (holds<Symbol>(value))
+					throw InterpreterException("Unexpected symbol: " + std::get<Symbol>(value).value);
 
-			case Token::Type::Operator:
-			{
-				const auto& op = Parser::s_Operators[token.value];
+				if (!holds<T>(value))
+					throw InterpreterException(error);
 
-				std::vector<Object> arguments(op.arguments);
+				return std::get<T>(value).value;
+			};
 
-				// Save all operator arguments if there are enough on the stack
-				if (solving.size() < op.arguments)
-					throw InterpreterException("Not enough arguments for the operator: " + token.value);
+#define unwrap_value(type, index, error) unwrap_value.template operator()<type>(index, error)
 
-				for (auto& arg : arguments)
-				{
-					arg = solving.back();
-					solving.pop_back();
-				}
+		if (type == Instruction::Type::Length)
+		{
+			const auto& value = value_of(0);
+
+			if (holds<Array>(value))
+				object = Numeric{ (long double)std::get<Array>(value).value.size() };
+			else if (holds<String>(value))
+				object = Numeric{ (long double)std::get<String>(value).value.size() };
+			else
+				throw InterpreterException("Can only get length of an array or a string");
+		}
+		else if (unary && holds<Array>(value_of(0)))
+		{
+			const auto& array = std::get<Array>(value_of(0)).value;
 
-				Object object;
+			Array result;
+			result.value.resize(array.size());
 
-#define holds std::holds_alternative
+			const double sign = type == Instruction::Type::UnaryMinus ? -1.0 : 1.0;
+			kernel::Apply(kernel::Operation::Multiplication, array.data(), false, &sign, true, result.value.data(), array.size());
 
-				auto unwrap_value = [&]<class T>(size_t index, const std::string& error = "")
-					{
-						if (holds<Symbol>(arguments[index]))
-						{
-							std::string name = std::get<Symbol>(arguments[index]).value;
+			object = std::move(result);
+		}
+		else if (unary)
+		{
+			// Handle unary operators
+			const auto number = unwrap_value(Numeric, 0, "Can't apply unary operator to the non-numeric value");
 
-							// Let's check if a variable with the given name exists
-							const auto variable = m_GlobalScope.Get(name);
+			switch (type)
+			{
+			case Instruction::Type::UnaryMinus: object = Numeric{ -number }; break;
+			case Instruction::Type::UnaryPlus:  object = Numeric{ +number }; break;
+			}
+		}
+		else
+		{
+			// Handle binary operators
 
-							if (variable)
-							{
-								// The variable exists...
+			const bool arithmetic = type != Instruction::Type::Equals && type != Instruction::Type::Assign;
 
-								const auto value = variable.value().get();
+			if (type == Instruction::Type::Index)
+			{
+				if (!holds<Array>(value_of(1)))
+					throw InterpreterException("Only arrays can be indexed");
 
-								if (!holds<T>(value))
-								{
-									// ... but it doesn't have type that we want
-									throw InterpreterException(error);
-								}
+				const auto& array = std::get<Array>(value_of(1)).value;
+				const auto index = unwrap_value(Numeric, 0, "Index of an array must be a number");
 
-								// ... and it's of the right type so return it
-								return std::get<T>(value).value;
-							}
+				// Written so NaN fails the range check before it's converted
+				if (!(index >= 0 && index < array.size()) || index != (long double)(size_t)index)
+					throw InterpreterException("Index is out of range: " + std::to_string((double)index));
 
-							// Couldn't find variable so assume it was an invalid symbol
-							throw InterpreterException("Unexpected symbol: " + name);
-						}
+				object = Numeric{ array[(size_t)index] };
+			}
+			else if (type != Instruction::Type::Assign && (holds<Array>(value_of(1)) || holds<Array>(value_of(0))))
+			{
+				// Operators are applied element by element, a number is used with every element
+				object = Broadcast(type, value_of(1), value_of(0));
+			}
+			else if (arithmetic && holds<String>(value_of(1)))
+			{
+				// You can concatenate a string with another string
 
-						if (!holds<T>(arguments[index]))
-							throw InterpreterException(error);
+				const auto& lhs = unwrap_value(String, 1, "");
 
-						return std::get<T>(arguments[index]).value;
-					};
+				if (type != Instruction::Type::Addition)
+					throw InterpreterException("Can perform only concatenation (+) with strings: " + lhs);
 
-#define unwrap_value(type, index, error) unwrap_value.template operator()<type>(index, error)
+				const auto& rhs = unwrap_value(String, 0, "Can only concatenate a string with another string: " + lhs);
 
-				switch (op.arguments)
+				object = Concatenate(lhs, rhs);
+			}
+			else
+			{
+				switch (type)
 				{
-				case 1:
+				case Instruction::Type::Equals:
 				{
-					// Handle unary operators
-					const auto number = unwrap_value(Numeric, 0, "Can't apply unary operator to the non-numeric value");
+					if (value_of(1).index() != value_of(0).index())
+						throw InterpreterException("Can't compare values of different types");
 
-					switch (op.type)
+					auto check_types = [&]<class T>(const std::string& name)
 					{
-					case Operator::Type::Subtraction: object = Numeric{ -number }; break;
-					case Operator::Type::Addition:    object = Numeric{ +number }; break;
-					}
+						if (holds<T>(value_of(1)))
+						{
+							const auto& lhs = unwrap_value(T, 1, "");
+							const auto& rhs = unwrap_value(T, 0, "Can only compare a " + name + " with another " + name);
+
+							object = Boolean{ lhs == rhs };
+							return true;
+						}
+
+						return false;
+					};
+
+					if (check_types.template operator()<Numeric>("number"));
+					else if (check_types.template operator()<String>("string"));
+					else if (check_types.template operator()<Boolean>("boolean"));
+					else
+						throw InterpreterException("Can't compare 2 values");
 				}
 				break;
 
-				case 2:
+				case Instruction::Type::Assign:
 				{
-					// Handle binary operators
+					const auto& target = Dereference(argument(1));
 
-					if (holds<String>(arguments[1]))
-					{
-						// You can concatenate a string with another string
+					if (!holds<Symbol>(target))
+						throw InterpreterException("Can't create a variable with an invalid name");
 
-						const auto lhs = unwrap_value(String, 1, "");
+					// A temporary value is moved rather than copied
+					if (&value_of(0) == &argument(0))
+						object = Take(argument(0));
+					else
+						object = value_of(0);
 
-						if (op.type != Operator::Type::Addition)
-							throw InterpreterException("Can perform only concatenation (+) with strings: " + lhs);
+					const auto& name = std::get<Symbol>(target).value;
 
-						const auto rhs = unwrap_value(String, 0, "Can only concatenate a string with another string: " + lhs);
+					// Host variables are written directly into the host memory
+					const auto binding = m_Bindings.find(name);
 
-						object = String { lhs + rhs };
-					}
+					if (binding != m_Bindings.end())
+						WriteBinding(binding->second, object);
 					else
+						m_GlobalScope.Assign(name, object);
+				}
+				break;
+
+				default:
+				{
+					const auto lhs = unwrap_value(Numeric, 1, "You must have numeric values to perform arithmetic operations");
+					const auto rhs = unwrap_value(Numeric, 0, "You must have numeric values to perform arithmetic operations");
+
+					switch (type)
 					{
-						switch (op.type)
-						{
-						case Operator::Type::Equals:
-						{
-							if (arguments[1].index() != arguments[0].index())
-								throw InterpreterException("Can't compare values of different types");
-
-							auto check_types = [&]<class T>(const std::string& name)
-							{
-								if (holds<T>(arguments[1]))
-								{
-									const auto lhs = unwrap_value(T, 1, "");
-									const auto rhs = unwrap_value(T, 0, "Can only compare a " + name + " with another " + name);
-
-									object = Boolean{ lhs == rhs };
-									return true;
-								}
-
-								return false;
-							};
-
-							if (check_types.template operator()<Numeric>("number"));
-							else if (check_types.template operator()<String>("string"));
-							else if (check_types.template operator()<Boolean>("boolean"));
-							else
-								throw InterpreterException("Can't compare 2 values");
-						}
-						break;
+					case Instruction::Type::Subtraction:    object = Numeric{ lhs - rhs };  break;
+					case Instruction::Type::Addition:       object = Numeric{ lhs + rhs };  break;
+					case Instruction::Type::Multiplication: object = Numeric{ lhs * rhs };  break;
+					case Instruction::Type::Division:       object = Numeric{ lhs / rhs };  break;
+					}
+				}
 
-						case Operator::Type::Assign:
-						{
-							if (!holds<Symbol>(arguments[1]))
-								throw InterpreterException("Can't create a variable with an invalid name");
+				};
+			}
+		}
 
-							m_GlobalScope.Assign(
-								std::get<Symbol>(arguments[1]).value,
-								arguments[0]
-							);
+		for (size_t i = 0; i < count; i++)
+			Pop(solving);
 
-							object = arguments[0];
-						}
-						break;
+		Push(solving, std::move(object));
 
-						default:
-						{
-							const auto lhs = unwrap_value(Numeric, 1, "You must have numeric values to perform arithmetic operations");
-							const auto rhs = unwrap_value(Numeric, 0, "You must have numeric values to perform arithmetic operations");
-
-							switch (op.type)
-							{
-							case Operator::Type::Subtraction:    object = Numeric{ lhs - rhs };  break;
-							case Operator::Type::Addition:       object = Numeric{ lhs + rhs };  break;
-							case Operator::Type::Multiplication: object = Numeric{ lhs * rhs };  break;
-							case Operator::Type::Division:       object = Numeric{ lhs / rhs };  break;
-							}
-						}
+#undef unwrap_value
+#undef holds
+	}
 
-						};
-					}
-				}
-				break;
+	void Interpreter::Push(std::vector<Object>& solving, Object&& object)
+	{
+		// All objects on the stack are accounted by the memory tracker
+		m_Memory.Allocate(MemoryTracker::SizeOf(object));
+		solving.push_back(std::move(object));
+	}
 
-				}
+	void Interpreter::Pop(std::vector<Object>& solving)
+	{
+		m_Memory.Free(MemoryTracker::SizeOf(solving.back()));
+		solving.pop_back();
+	}
 
-				solving.push_back(object);
+	Object Interpreter::Take(Object& slot)
+	{
+		const size_t size = MemoryTracker::SizeOf(slot);
+
+		Object object = std::exchange(slot, Numeric{});
+		m_Memory.Free(size - MemoryTracker::SizeOf(slot));
+
+		return object;
+	}
+
+	void Interpreter::OperateBinary(std::vector<Object>& solving, const Instruction& instruction)
+	{
+		if (solving.size() >= 2)
+		{
+			const auto& lhs = Resolve(solving[solving.size() - 2]);
+			const auto& rhs = Resolve(solving.back());
+
+			Object result;
+
+			if (Specialise(instruction, instruction.type, lhs, rhs, result))
+			{
+				Pop(solving);
+				Pop(solving);
+				Push(solving, std::move(result));
+				return;
 			}
-			break;
+		}
+
+		Operate(solving, instruction.type);
+	}
+
+	void Interpreter::OperateConstant(std::vector<Object>& solving, const Instruction& instruction, const Object& constant)
+	{
+		Instruction::Type type;
+
+		switch (instruction.type)
+		{
+		case Instruction::Type::AddConstant:      type = Instruction::Type::Addition;       break;
+		case Instruction::Type::SubtractConstant: type = Instruction::Type::Subtraction;    break;
+		case Instruction::Type::MultiplyConstant: type = Instruction::Type::Multiplication; break;
+		default:                                  type = Instruction::Type::Division;       break;
+		}
 
+		if (!solving.empty())
+		{
+			Object result;
+
+			if (Specialise(instruction, type, Resolve(solving.back()), constant, result))
+			{
+				Pop(solving);
+				Push(solving, std::move(result));
+				return;
 			}
+		}
 
-#undef unwrap_value
-#undef holds
+		Push(solving, Reference{ &constant });
+		Operate(solving, type);
+	}
+
+	void Interpreter::AssignAddConstant(std::vector<Object>& solving, const Object& constant)
+	{
+		if (solving.empty() || !std::holds_alternative<Symbol>(Dereference(solving.back())))
+			throw InterpreterException("Can't create a variable with an invalid name");
+
+		const auto& name = std::get<Symbol>(Dereference(solving.back())).value;
+
+		// Host variables and anything but numbers go through the generic operators
+		if (std::holds_alternative<Numeric>(constant) && (m_Bindings.empty() || !m_Bindings.contains(name)))
+		{
+			const auto variable = m_GlobalScope.Get(name);
+
+			if (variable && std::holds_alternative<Numeric>(variable.value().get()))
+			{
+				auto& value = std::get<Numeric>(variable.value().get()).value;
+				value += std::get<Numeric>(constant).value;
+
+				const Numeric result{ value };
+
+				Pop(solving);
+				Push(solving, result);
+				return;
+			}
 		}
 
-		// Just for now we only have double as a result
+		Push(solving, Object(solving.back()));
+		Push(solving, Reference{ &constant });
 
-		if (!solving.empty())
-			return solving.back();
+		Operate(solving, Instruction::Type::Addition);
+		Operate(solving, Instruction::Type::Assign);
+	}
+
+	bool Interpreter::Compare(std::vector<Object>& solving, const Instruction& instruction)
+	{
+		Object result;
+
+		if (solving.size() >= 2 && Specialise(instruction, Instruction::Type::Equals, Resolve(solving[solving.size() - 2]), Resolve(solving.back()), result))
+		{
+			Pop(solving);
+			Pop(solving);
+		}
+		else
+		{
+			Operate(solving, Instruction::Type::Equals);
+
+			result = Take(solving.back());
+			Pop(solving);
+		}
+
+		// Arrays are compared element by element so the result isn't a boolean
+		if (!std::holds_alternative<Boolean>(result))
+			throw InterpreterException("Condition must be a boolean");
+
+		return std::get<Boolean>(result).value;
+	}
+
+	bool Interpreter::CompareConstant(std::vector<Object>& solving, const Instruction& instruction, const Object& constant)
+	{
+		Object result;
+
+		if (solving.empty() || !Specialise(instruction, Instruction::Type::Equals, Resolve(solving.back()), constant, result))
+		{
+			// Anything but the cached types goes through the generic comparison
+			Push(solving, Reference{ &constant });
+			return Compare(solving, instruction);
+		}
+
+		Pop(solving);
+
+		if (!std::holds_alternative<Boolean>(result))
+			throw InterpreterException("Condition must be a boolean");
+
+		return std::get<Boolean>(result).value;
+	}
+
+	bool Interpreter::Specialise(const Instruction& instruction, Instruction::Type type, const Object& lhs, const Object& rhs, Object& result)
+	{
+		if (Apply(instruction.cache.Get(), type, lhs, rhs, result))
+			return true;
+
+		// The guard failed so the site is specialised for the new types, a generic site stays
+		// generic and isn't written again so threads sharing the program don't contend for it
+		const auto cache = Classify(type, lhs, rhs);
+
+		if (cache != instruction.cache.Get())
+			instruction.cache.Set(cache);
+
+		return Apply(cache, type, lhs, rhs, result);
+	}
+
+	bool Interpreter::Apply(InlineCache::Type cache, Instruction::Type type, const Object& lhs, const Object& rhs, Object& result)
+	{
+		switch (cache)
+		{
+		case InlineCache::Type::Numbers:
+		{
+			const auto a = std::get_if<Numeric>(&lhs);
+			const auto b = std::get_if<Numeric>(&rhs);
+
+			if (!a || !b)
+				return false;
+
+			switch (type)
+			{
+			case Instruction::Type::Subtraction:    result = Numeric{ a->value - b->value };  break;
+			case Instruction::Type::Addition:       result = Numeric{ a->value + b->value };  break;
+			case Instruction::Type::Multiplication: result = Numeric{ a->value * b->value };  break;
+			case Instruction::Type::Division:       result = Numeric{ a->value / b->value };  break;
+			case Instruction::Type::Equals:         result = Boolean{ a->value == b->value }; break;
+			default: return false;
+			}
+		}
+		return true;
+
+		case InlineCache::Type::Strings:
+		{
+			const auto a = std::get_if<String>(&lhs);
+			const auto b = std::get_if<String>(&rhs);
+
+			if (!a || !b)
+				return false;
+
+			switch (type)
+			{
+			case Instruction::Type::Addition: result = Concatenate(a->value, b->value); break;
+			case Instruction::Type::Equals:   result = Boolean{ a->value == b->value }; break;
+			default: return false;
+			}
+		}
+		return true;
+
+		case InlineCache::Type::Booleans:
+		{
+			const auto a = std::get_if<Boolean>(&lhs);
+			const auto b = std::get_if<Boolean>(&rhs);
+
+			if (!a || !b || type != Instruction::Type::Equals)
+				return false;
+
+			result = Boolean{ a->value == b->value };
+		}
+		return true;
+
+		default:
+			return false;
+		}
+	}
+
+	String Interpreter::Concatenate(const std::string& lhs, const std::string& rhs)
+	{
+		// operator+ copies the left string and then grows it, this allocates only once
+		String result;
+		result.value.reserve(lhs.size() + rhs.size());
+
+		result.value += lhs;
+		result.value += rhs;
+
+		return result;
+	}
+
+	InlineCache::Type Interpreter::Classify(Instruction::Type type, const Object& lhs, const Object& rhs)
+	{
+		if (lhs.index() != rhs.index())
+			return InlineCache::Type::Generic;
+
+		const bool equals = type == Instruction::Type::Equals;
+
+		if (std::holds_alternative<Numeric>(lhs))
+			return InlineCache::Type::Numbers;
+
+		// Other operators on strings and booleans are errors reported by the generic path
+		if (std::holds_alternative<String>(lhs) && (equals || type == Instruction::Type::Addition))
+			return InlineCache::Type::Strings;
+
+		if (std::holds_alternative<Boolean>(lhs) && equals)
+			return InlineCache::Type::Booleans;
+
+		return InlineCache::Type::Generic;
+	}
+
+	const Object& Interpreter::Dereference(const Object& object)
+	{
+		if (const auto reference = std::get_if<Reference>(&object))
+			return *reference->value;
+
+		return object;
+	}
+
+	const Object& Interpreter::Resolve(const Object& borrowed)
+	{
+		const auto& object = Dereference(borrowed);
+
+		if (std::holds_alternative<Symbol>(object))
+		{
+			const auto& name = std::get<Symbol>(object).value;
+
+			if (!m_Bindings.empty())
+			{
+				// Host variables are read every time so the script sees their latest values
+				const auto binding = m_Bindings.find(name);
+
+				if (binding != m_Bindings.end())
+					return ReadBinding(binding->second);
+			}
+
+			const auto variable = m_GlobalScope.Get(name);
+
+			if (variable)
+				return variable.value().get();
+
+			if (m_Fallback)
+			{
+				if (const auto borrowed = m_Fallback->GetVariable(name))
+					return *borrowed;
+			}
+
+			if (m_Snapshot)
+			{
+				if (const auto shared = SharedScope::Find(*m_Snapshot, name))
+					return *shared;
+			}
+		}
+
+		return object;
+	}
+
+	void Interpreter::Call(Continuation& continuation, const Function& function, size_t count)
+	{
+		auto& solving = continuation.stack;
+
+		if (function.arity != count)
+			throw InterpreterException("Function " + function.name + " expects " + std::to_string(function.arity) + " arguments");
+
+		const size_t base = solving.size() - count;
+
+		// Arguments become locals of the frame so variables are replaced with their current values
+		for (size_t i = base; i < solving.size(); i++)
+		{
+			const auto& value = Resolve(solving[i]);
+
+			if (&value != &solving[i])
+			{
+				Object copy = value;
+
+				m_Memory.Allocate(MemoryTracker::SizeOf(copy));
+				m_Memory.Free(MemoryTracker::SizeOf(solving[i]));
+
+				solving[i] = std::move(copy);
+			}
+		}
+
+		// A call right before the return (maybe through a jump out of a condition)
+		// doesn't need the frame of the caller anymore so the callee takes its place
+		const auto& instructions = continuation.program->instructions;
+
+		auto returns = [&](size_t pointer)
+			{
+				return pointer < instructions.size() && instructions[pointer].type == Instruction::Type::Return;
+			};
+
+		const size_t next = continuation.pointer;
+
+		const bool tail = !continuation.frames.empty() &&
+			(returns(next) || (next < instructions.size() && instructions[next].type == Instruction::Type::Jump && returns(instructions[next].operand)));
+
+		if (tail)
+		{
+			const size_t callee = continuation.base - 1;
+
+			for (size_t i = callee; i < base - 1; i++)
+				m_Memory.Free(MemoryTracker::SizeOf(solving[i]));
+
+			std::move(solving.begin() + (base - 1), solving.end(), solving.begin() + callee);
+			solving.resize(callee + count + 1);
+
+			continuation.base = callee + 1;
+		}
+		else
+		{
+			if (continuation.frames.size() >= m_MaxCallDepth)
+				throw InterpreterException("Maximum call depth exceeded in " + function.name + ": " + std::to_string(m_MaxCallDepth));
+
+			continuation.frames.push_back({ continuation.program, std::move(continuation.body), continuation.pointer, continuation.base });
+			continuation.base = base;
+		}
+
+		// A recursive call leaves the body to the frame of the caller, or whoever owns it below,
+		// so the reference count isn't touched. Otherwise the body of a replaced frame
+		// may be released here so nothing of it is used after
+		if (function.body.get() != continuation.program)
+			continuation.body = function.body;
+
+		continuation.program = function.body.get();
+		continuation.pointer = 0;
+	}
+
+	void Interpreter::Return(Continuation& continuation)
+	{
+		auto& solving = continuation.stack;
+
+		if (continuation.frames.empty())
+			throw InterpreterException("Return outside of a function");
+
+		if (solving.size() <= continuation.base)
+			throw InterpreterException("Function finished without returning a value");
+
+		// The result replaces the callee and its arguments, variables are returned by value
+		const auto& value = Resolve(solving.back());
+		Object result = &value == &solving.back() ? Take(solving.back()) : value;
+
+		for (size_t i = continuation.base - 1; i < solving.size(); i++)
+			m_Memory.Free(MemoryTracker::SizeOf(solving[i]));
+
+		solving.resize(continuation.base - 1);
+
+		auto& frame = continuation.frames.back();
 
-		return std::nullopt;
+		continuation.program = frame.program;
+		continuation.body = std::move(frame.body);
+		continuation.pointer = frame.pointer;
+		continuation.base = frame.base;
+
+		continuation.frames.pop_back();
+
+		m_Memory.Allocate(MemoryTracker::SizeOf(result));
+		solving.push_back(std::move(result));
+	}
+
+	void Interpreter::SetMaxCallDepth(size_t depth)
+	{
+		m_MaxCallDepth = depth;
+	}
+
+	bool Interpreter::IsBound(const std::string& name) const
+	{
+		return m_Bindings.contains(name);
+	}
+
+	const Object* Interpreter::GetVariable(const std::string& name) const
+	{
+		return m_GlobalScope.Find(name);
+	}
+
+	void Interpreter::SetVariable(const std::string& name, Object value)
+	{
+		m_GlobalScope.Assign(name, std::move(value));
 	}
 
-	void Interpreter::ParseIf(std::deque<Object>& solving)
+	void Interpreter::RemoveVariable(const std::string& name)
 	{
+		m_GlobalScope.Remove(name);
+	}
+
+	std::optional<Object> Interpreter::TakeVariable(const std::string& name)
+	{
+		return m_GlobalScope.Take(name);
+	}
+
+	void Interpreter::RegisterNative(const std::string& name, size_t arity, NativeFunction function)
+	{
+		if (arity > MAX_NATIVE_ARGUMENTS)
+			throw InterpreterException("Too many arguments for the native function: " + name);
+
+		m_Natives[name] = { arity, std::move(function) };
+	}
+
+	void Interpreter::Bind(const std::string& name, Binding binding)
+	{
+		m_Bindings[name] = { binding, Object() };
+	}
+
+	const Object& Interpreter::ReadBinding(HostVariable& variable)
+	{
+		// Host objects are borrowed as they are
+		if (const auto object = std::get_if<Object*>(&variable.binding))
+			return **object;
+
+		std::visit([&](auto pointer)
+			{
+				using T = std::remove_pointer_t<decltype(pointer)>;
+
+				// Objects are returned above
+				if constexpr (std::is_same_v<T, Object>)
+					return;
+				else if constexpr (std::is_same_v<T, bool>)
+					variable.value = Boolean{ *pointer };
+				else if constexpr (std::is_same_v<T, std::string>)
+				{
+					// Reading an unchanged string doesn't allocate, a changed one reuses the buffer if it fits
+					if (!std::holds_alternative<String>(variable.value))
+						variable.value = String{ *pointer };
+					else if (auto& copy = std::get<String>(variable.value).value; copy != *pointer)
+						copy = *pointer;
+				}
+				else
+					variable.value = Numeric{ (long double)*pointer };
+			}, variable.binding);
+
+		return variable.value;
+	}
+
+	void Interpreter::WriteBinding(HostVariable& variable, const Object& value)
+	{
+		std::visit([&](auto pointer)
+			{
+				using T = std::remove_pointer_t<decltype(pointer)>;
+
+				if constexpr (std::is_same_v<T, Object>)
+				{
+					// The host reads the object as the type it bound
+					if (pointer->index() != value.index())
+						throw InterpreterException("Can only assign a value of the same type to the host variable");
+
+					*pointer = value;
+				}
+				else if constexpr (std::is_same_v<T, bool>)
+				{
+					if (!std::holds_alternative<Boolean>(value))
+						throw InterpreterException("Can only assign a boolean to the host variable");
+
+					*pointer = std::get<Boolean>(value).value;
+				}
+				else if constexpr (std::is_same_v<T, std::string>)
+				{
+					if (!std::holds_alternative<String>(value))
+						throw InterpreterException("Can only assign a string to the host variable");
+
+					*pointer = std::get<String>(value).value;
+				}
+				else
+				{
+					if (!std::holds_alternative<Numeric>(value))
+						throw InterpreterException("Can only assign a number to the host variable");
+
+					*pointer = T(std::get<Numeric>(value).value);
+				}
+			}, variable.binding);
+	}
+
+	Object Interpreter::Broadcast(Instruction::Type type, const Object& lhs, const Object& rhs)
+	{
+		kernel::Operation operation;
+
+		switch (type)
+		{
+		case Instruction::Type::Subtraction:    operation = kernel::Operation::Subtraction;    break;
+		case Instruction::Type::Addition:       operation = kernel::Operation::Addition;       break;
+		case Instruction::Type::Multiplication: operation = kernel::Operation::Multiplication; break;
+		case Instruction::Type::Division:       operation = kernel::Operation::Division;       break;
+		case Instruction::Type::Equals:         operation = kernel::Operation::Equals;         break;
+		default: throw InterpreterException("The operator can't be applied to arrays");
+		}
+
+		// A number is treated as a single element that is used with every element of the array
+		struct Operand
+		{
+			const double* data;
+			size_t size;
+			bool scalar;
+			double number;
+		};
+
+		auto to_operand = [](const Object& object)
+			{
+				Operand operand{};
+
+				if (std::holds_alternative<Array>(object))
+				{
+					const auto& array = std::get<Array>(object).value;
+					operand = { array.data(), array.size(), false, 0.0 };
+				}
+				else if (std::holds_alternative<Numeric>(object))
+				{
+					operand.scalar = true;
+					operand.number = double(std::get<Numeric>(object).value);
+				}
+				else
+					throw InterpreterException("Arrays can only be combined with numbers or other arrays");
+
+				return operand;
+			};
+
+		Operand left = to_operand(lhs), right = to_operand(rhs);
+
+		if (left.scalar) left.data = &left.number;
+		if (right.scalar) right.data = &right.number;
+
+		if (!left.scalar && !right.scalar && left.size != right.size)
+			throw InterpreterException("Arrays must have the same size");
+
+		Array result;
+		result.value.resize(left.scalar ? right.size : left.size);
+
+		kernel::Apply(operation, left.data, left.scalar, right.data, right.scalar, result.value.data(), result.value.size());
+
+		return result;
 	}
 
-	void Interpreter::ParseWhile(std::deque<Object>& solving)
+	void Interpreter::ParseWhile(std::vector<Object>& solving)
 	{
 	}
 
-	void Interpreter::ParseFor(std::deque<Object>& solving)
+	void Interpreter::ParseFor(std::vector<Object>& solving)
 	{
 	}
 }
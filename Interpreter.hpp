@@ -1,15 +1,86 @@
 #pragma once
 
-#include <deque>
+#include <vector>
 #include <variant>
+#include <memory>
+#include <string_view>
+#include <limits>
+#include <functional>
+#include <unordered_map>
 
 #include "Operator.hpp"
 #include "Parser.hpp"
+#include "Compiler.hpp"
+#include "Cache.hpp"
+#include "Program.hpp"
 #include "Token.hpp"
 #include "Scope.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "SharedScope.hpp"
 
 namespace def
 {
+	// State of a suspended program, the execution can be resumed from it later
+	struct Continuation
+	{
+		Continuation(const Program& program);
+
+		bool IsFinished() const;
+
+		static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+		// Where the execution continues after the called function returns
+		struct Frame
+		{
+			const Program* program;
+
+			// Keeps the body of the caller alive if its function is redefined, empty for the main program
+			std::shared_ptr<const Program> body;
+
+			size_t pointer;
+			size_t base;
+		};
+
+		// The program being executed, either the main one or the body of a function,
+		// the main program must outlive the continuation
+		const Program* program;
+
+		// Owns the body of the function being executed, empty in the main program
+		// and in recursive calls where a frame below owns it
+		std::shared_ptr<const Program> body;
+
+		// Index of the next instruction
+		size_t pointer = 0;
+
+		// Index of the first argument of the current function on the stack,
+		// the callee is right below it
+		size_t base = 0;
+
+		// Frames of the callers, arguments and temporaries of all of them share the value stack
+		std::vector<Frame> frames;
+
+		std::vector<Object> stack;
+
+		// Total number of executed instructions
+		size_t executed = 0;
+
+		// Set only when the program is finished
+		std::optional<Object> result;
+
+		// Version of the shared variables the program sees from start to finish
+		SharedScope::Snapshot snapshot;
+	};
+
+	// Native functions get pointers to their arguments, variables are already replaced with their values
+	using NativeFunction = std::function<Object(const Object* const* arguments)>;
+
+	// A host variable that scripts read and write directly. Numbers and booleans are read straight
+	// from the host memory. A std::string is compared with the latest copy on every read, which costs
+	// its length, and copied again only when changed. An Object (e.g. holding a String) is read
+	// in place without any copy or comparison, scripts may only assign values of the same type to it
+	using Binding = std::variant<long double*, double*, bool*, std::string*, Object*>;
+
 	class Interpreter
 	{
 	public:
@@ -18,13 +89,162 @@ namespace def
 	public:
 		std::optional<Object> Solve(const std::vector<Token>& tokens);
 
+		// Tokenises and compiles the source or takes the program from the cache if there is one
+		std::optional<Object> Evaluate(std::string_view source);
+
+		std::optional<Object> Execute(const Program& program);
+
+		// Executes at most budget instructions and returns the state to resume from
+		Continuation Execute(const Program& program, size_t budget);
+
+		// Continues the execution for at most budget instructions, returns true if the program is finished
+		bool Resume(Continuation& continuation, size_t budget);
+
+		void RegisterNative(const std::string& name, size_t arity, NativeFunction function);
+
+		// Binds the name to the host memory, it hides a global variable with the same name
+		void Bind(const std::string& name, Binding binding);
+
+		static constexpr size_t MAX_NATIVE_ARGUMENTS = 16;
+
+		bool IsBound(const std::string& name) const;
+
+		// Direct access to global variables, host bindings and the shared scope are not involved.
+		// GetVariable only reads so several threads can call it while nothing is executed
+		const Object* GetVariable(const std::string& name) const;
+		void SetVariable(const std::string& name, Object value);
+		void RemoveVariable(const std::string& name);
+
+		// Removes the variable and returns its value without copying it
+		std::optional<Object> TakeVariable(const std::string& name);
+
+		// Scripts fail with an InterpreterException when calls are nested deeper than the limit,
+		// calls in the tail position reuse the frame so they don't count
+		void SetMaxCallDepth(size_t depth);
+
+		static constexpr size_t DEFAULT_MAX_CALL_DEPTH = 10000;
+
+		// Scripts fail with an InterpreterException when they hold more memory than the limit
+		void SetMemoryLimit(size_t bytes);
+		const MemoryTracker& GetMemory() const;
+
+		// Writes all global variables into a binary file
+		bool SaveSnapshot(const std::string& path) const;
+
+		// Replaces all global variables with the ones from the snapshot,
+		// returns false if the file is missing or invalid
+		bool LoadSnapshot(const std::string& path);
+
+		// Records pairs of executed opcodes while it's set, nullptr turns profiling off
+		void SetProfiler(std::shared_ptr<Profiler> profiler);
+
+		// Names that aren't global variables of the interpreter are looked up in the shared scope,
+		// every program sees the version that was current when it started.
+		// Assignments always create variables of the interpreter that hide the shared ones
+		void SetSharedScope(std::shared_ptr<SharedScope> scope);
+		std::shared_ptr<SharedScope> GetSharedScope() const;
+
+		// Names that aren't global variables of the interpreter are read from the globals of the
+		// fallback before the shared scope. The fallback is borrowed and must not change while
+		// this interpreter executes, nullptr turns it off
+		void SetFallback(const Interpreter* fallback);
+
+		// Forgets all global variables and functions, natives and bindings stay.
+		// Suspended continuations keep the bodies of the functions they are running
+		void Reset();
+
+		// The cache can be shared between several interpreters
+		void SetCache(std::shared_ptr<ProgramCache> cache);
+		std::shared_ptr<ProgramCache> GetCache() const;
+
+	private:
+		struct Native
+		{
+			size_t arity;
+			NativeFunction function;
+		};
+
+		struct HostVariable
+		{
+			Binding binding;
+
+			// The latest value that was read from the host memory
+			Object value;
+		};
+
 	private:
-		void ParseIf(std::deque<Object>& solving);
-		void ParseWhile(std::deque<Object>& solving);
-		void ParseFor(std::deque<Object>& solving);
+		bool Run(Continuation& continuation, size_t budget);
+
+		void Push(std::vector<Object>& solving, Object&& object);
+		void Pop(std::vector<Object>& solving);
+
+		// Moves the object out of the stack slot and leaves a number in its place
+		Object Take(Object& slot);
+
+		// Pops the arguments of the operator and pushes its result
+		void Operate(std::vector<Object>& solving, Instruction::Type type);
+
+		// Operator sites try the handler for the types they saw last time
+		// and fall back to the generic operators if the types don't match
+		void OperateBinary(std::vector<Object>& solving, const Instruction& instruction);
+		void OperateConstant(std::vector<Object>& solving, const Instruction& instruction, const Object& constant);
+		bool Compare(std::vector<Object>& solving, const Instruction& instruction);
+		bool CompareConstant(std::vector<Object>& solving, const Instruction& instruction, const Object& constant);
+
+		void AssignAddConstant(std::vector<Object>& solving, const Object& constant);
+
+		// Returns false if the generic path is needed, the cache of the site is updated on a miss
+		static bool Specialise(const Instruction& instruction, Instruction::Type type, const Object& lhs, const Object& rhs, Object& result);
+		static bool Apply(InlineCache::Type cache, Instruction::Type type, const Object& lhs, const Object& rhs, Object& result);
+		static InlineCache::Type Classify(Instruction::Type type, const Object& lhs, const Object& rhs);
+		static String Concatenate(const std::string& lhs, const std::string& rhs);
+
+		// Returns the value of a variable or the object itself if it's not a variable,
+		// references are followed so the result is never a slot holding a borrowed value
+		const Object& Resolve(const Object& object);
+		static const Object& Dereference(const Object& object);
+
+		// Applies an arithmetic operator or a comparison to arrays element by element
+		Object Broadcast(Instruction::Type type, const Object& lhs, const Object& rhs);
+
+		const Object& ReadBinding(HostVariable& variable);
+		void WriteBinding(HostVariable& variable, const Object& value);
+
+		// Frees the value stack of the continuation
+		void Release(Continuation& continuation);
+
+		// Replaces the callee and its arguments on the top of the stack with a frame of the function
+		void Call(Continuation& continuation, const Function& function, size_t count);
+		void Return(Continuation& continuation);
+
+		void ParseWhile(std::vector<Object>& solving);
+		void ParseFor(std::vector<Object>& solving);
 
 	private:
+		Parser m_Parser;
+		Compiler m_Compiler;
+
+		MemoryTracker m_Memory;
+
 		Scope m_GlobalScope;
 
+		std::shared_ptr<ProgramCache> m_Cache;
+
+		std::unordered_map<std::string, Native> m_Natives;
+		std::unordered_map<std::string, HostVariable> m_Bindings;
+
+		std::unordered_map<std::string, Function> m_Functions;
+
+		size_t m_MaxCallDepth = DEFAULT_MAX_CALL_DEPTH;
+
+		std::shared_ptr<Profiler> m_Profiler;
+
+		std::shared_ptr<SharedScope> m_Shared;
+
+		const Interpreter* m_Fallback = nullptr;
+
+		// Variables of the snapshot pinned by the continuation being run
+		const SharedScope::Variables* m_Snapshot = nullptr;
+
 	};
 }
@@ -0,0 +1,74 @@
+#include "Kernels.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEF_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace def
+{
+	namespace kernel
+	{
+		// Processes 2 elements at a time with SSE2 and the tail (or everything if there's no SSE2) one by one
+		template <class VectorOp, class ScalarOp>
+		static void Loop(const double* lhs, bool lhsScalar, const double* rhs, bool rhsScalar, double* out, size_t count, VectorOp vectorOp, ScalarOp scalarOp)
+		{
+			size_t i = 0;
+
+#ifdef DEF_SSE2
+			const __m128d lhsBroadcast = _mm_set1_pd(*lhs);
+			const __m128d rhsBroadcast = _mm_set1_pd(*rhs);
+
+			for (; i + 2 <= count; i += 2)
+			{
+				const __m128d a = lhsScalar ? lhsBroadcast : _mm_loadu_pd(lhs + i);
+				const __m128d b = rhsScalar ? rhsBroadcast : _mm_loadu_pd(rhs + i);
+
+				_mm_storeu_pd(out + i, vectorOp(a, b));
+			}
+#endif
+
+			for (; i < count; i++)
+				out[i] = scalarOp(lhsScalar ? *lhs : lhs[i], rhsScalar ? *rhs : rhs[i]);
+		}
+
+#ifdef DEF_SSE2
+#define DEF_VECTOR_OP(body) [](__m128d a, __m128d b) { return body; }
+#else
+#define DEF_VECTOR_OP(body) nullptr
+#endif
+
+		void Apply(Operation operation, const double* lhs, bool lhsScalar, const double* rhs, bool rhsScalar, double* out, size_t count)
+		{
+			if (count == 0)
+				return;
+
+			switch (operation)
+			{
+			case Operation::Subtraction:
+				Loop(lhs, lhsScalar, rhs, rhsScalar, out, count, DEF_VECTOR_OP(_mm_sub_pd(a, b)), [](double a, double b) { return a - b; });
+				break;
+
+			case Operation::Addition:
+				Loop(lhs, lhsScalar, rhs, rhsScalar, out, count, DEF_VECTOR_OP(_mm_add_pd(a, b)), [](double a, double b) { return a + b; });
+				break;
+
+			case Operation::Multiplication:
+				Loop(lhs, lhsScalar, rhs, rhsScalar, out, count, DEF_VECTOR_OP(_mm_mul_pd(a, b)), [](double a, double b) { return a * b; });
+				break;
+
+			case Operation::Division:
+				Loop(lhs, lhsScalar, rhs, rhsScalar, out, count, DEF_VECTOR_OP(_mm_div_pd(a, b)), [](double a, double b) { return a / b; });
+				break;
+
+			case Operation::Equals:
+				// The comparison gives a mask of all ones so keep only the bits of 1.0
+				Loop(lhs, lhsScalar, rhs, rhsScalar, out, count, DEF_VECTOR_OP(_mm_and_pd(_mm_cmpeq_pd(a, b), _mm_set1_pd(1.0))), [](double a, double b) { return a == b ? 1.0 : 0.0; });
+				break;
+
+			}
+		}
+
+#undef DEF_VECTOR_OP
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace def
+{
+	namespace kernel
+	{
+		enum class Operation
+		{
+			Subtraction,
+			Addition,
+			Multiplication,
+			Division,
+			Equals
+		};
+
+		// out[i] = lhs[i] op rhs[i], if a side is scalar then its only value is used for every element.
+		// Equals produces 1.0 or 0.0 for each pair of elements
+		void Apply(Operation operation, const double* lhs, bool lhsScalar, const double* rhs, bool rhsScalar, double* out, size_t count);
+	}
+}
@@ -0,0 +1,42 @@
+#include "Memory.hpp"
+#include "Exception.hpp"
+
+#include <algorithm>
+
+namespace def
+{
+	MemoryTracker::MemoryTracker(size_t limit) : m_Limit(limit)
+	{
+	}
+
+	void MemoryTracker::Exceed(size_t bytes) const
+	{
+		throw InterpreterException("Memory limit exceeded: " + std::to_string(m_Usage + bytes) + " of " + std::to_string(m_Limit) + " bytes");
+	}
+
+	size_t MemoryTracker::GetUsage() const
+	{
+		return m_Usage;
+	}
+
+	size_t MemoryTracker::GetPeak() const
+	{
+		return m_Peak;
+	}
+
+	void MemoryTracker::SetLimit(size_t limit)
+	{
+		m_Limit = limit;
+	}
+
+	size_t MemoryTracker::GetLimit() const
+	{
+		return m_Limit;
+	}
+
+	size_t MemoryTracker::SizeOf(const std::string& name, const Object& object)
+	{
+		// The node of std::unordered_map holds the key, the value, the next pointer and the hash
+		return SizeOf(object) + sizeof(std::string) + name.size() + 2 * sizeof(void*);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <limits>
+#include <cstddef>
+#include <algorithm>
+
+#include "Scope.hpp"
+
+namespace def
+{
+	// Counts bytes held by variables, strings and value stacks of one interpreter
+	class MemoryTracker
+	{
+	public:
+		MemoryTracker(size_t limit = UNLIMITED);
+
+	public:
+		// Throws an InterpreterException if the limit would be exceeded
+		void Allocate(size_t bytes);
+		void Free(size_t bytes);
+
+		size_t GetUsage() const;
+		size_t GetPeak() const;
+
+		void SetLimit(size_t limit);
+		size_t GetLimit() const;
+
+		// An approximate number of bytes an object takes including its heap memory
+		static size_t SizeOf(const Object& object);
+
+		// Same as SizeOf but also includes a name and a hash table node
+		static size_t SizeOf(const std::string& name, const Object& object);
+
+		static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+	private:
+		[[noreturn]] void Exceed(size_t bytes) const;
+
+	private:
+		size_t m_Usage = 0;
+		size_t m_Peak = 0;
+		size_t m_Limit;
+
+	};
+
+	// Every push and pop of the interpreter accounts its object so these are inlined
+
+	inline void MemoryTracker::Allocate(size_t bytes)
+	{
+		if (bytes > m_Limit - std::min(m_Usage, m_Limit))
+			Exceed(bytes);
+
+		m_Usage += bytes;
+		m_Peak = std::max(m_Peak, m_Usage);
+	}
+
+	inline void MemoryTracker::Free(size_t bytes)
+	{
+		m_Usage -= std::min(bytes, m_Usage);
+	}
+
+	inline size_t MemoryTracker::SizeOf(const Object& object)
+	{
+		// Only strings and arrays own heap memory
+		if (std::holds_alternative<String>(object))
+			return sizeof(Object) + std::get<String>(object).value.size();
+
+		if (std::holds_alternative<Symbol>(object))
+			return sizeof(Object) + std::get<Symbol>(object).value.size();
+
+		if (std::holds_alternative<Array>(object))
+			return sizeof(Object) + std::get<Array>(object).value.size() * sizeof(double);
+
+		return sizeof(Object);
+	}
+}
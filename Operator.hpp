@@ -13,7 +13,8 @@ namespace def
 			Multiplication,
 			Division,
 			Equals,
-			Assign
+			Assign,
+			Length
 		};
 
 		Type type;
@@ -0,0 +1,115 @@
+#include "Optimiser.hpp"
+
+namespace def
+{
+	void Optimiser::Optimise(Program& program)
+	{
+		const auto& instructions = program.instructions;
+
+		// A fused sequence must not be entered in the middle
+		std::vector<bool> targets(instructions.size() + 1, false);
+
+		for (const auto& instruction : instructions)
+		{
+			if (instruction.type == Instruction::Type::Jump || instruction.type == Instruction::Type::JumpIfFalse)
+				targets[instruction.operand] = true;
+		}
+
+		std::vector<Instruction> optimised;
+		std::vector<uint32_t> offsets;
+
+		// New index of every old instruction to fix jumps up
+		std::vector<uint32_t> remap(instructions.size() + 1);
+
+		optimised.reserve(instructions.size());
+		offsets.reserve(instructions.size());
+
+		for (size_t i = 0; i < instructions.size();)
+		{
+			auto fusion = Match(program, targets, i);
+
+			if (fusion.length == 0)
+				fusion = { 1, instructions[i] };
+
+			for (size_t j = 0; j < fusion.length; j++)
+				remap[i + j] = uint32_t(optimised.size());
+
+			optimised.push_back(fusion.replacement);
+			offsets.push_back(i < program.offsets.size() ? program.offsets[i] : 0);
+
+			i += fusion.length;
+		}
+
+		remap[instructions.size()] = uint32_t(optimised.size());
+
+		std::vector<bool> landings(optimised.size() + 1, false);
+
+		for (auto& instruction : optimised)
+		{
+			switch (instruction.type)
+			{
+			case Instruction::Type::Jump:
+			case Instruction::Type::JumpIfFalse:
+			case Instruction::Type::JumpIfNotEqual:
+				instruction.operand = remap[instruction.operand];
+				landings[instruction.operand] = true;
+				break;
+			}
+		}
+
+		// n == c in a condition is the most frequent pair left after fusion: the push of the constant
+		// also compares and jumps, the JumpIfNotEqual stays in place only to hold the target
+		for (size_t i = 0; i + 1 < optimised.size(); i++)
+		{
+			if (optimised[i].type == Instruction::Type::PushConstant && optimised[i + 1].type == Instruction::Type::JumpIfNotEqual && !landings[i + 1])
+				optimised[i].type = Instruction::Type::JumpIfNotEqualConstant;
+		}
+
+		program.instructions = std::move(optimised);
+		program.offsets = std::move(offsets);
+	}
+
+	Optimiser::Fusion Optimiser::Match(const Program& program, const std::vector<bool>& targets, size_t index)
+	{
+		const auto& instructions = program.instructions;
+
+		// Jumps may only land on the first instruction of a sequence
+		auto is = [&](size_t offset, Instruction::Type type)
+			{
+				return index + offset < instructions.size() && instructions[index + offset].type == type && (offset == 0 || !targets[index + offset]);
+			};
+
+		// x = x + c: the first push of the symbol is kept as the target of the assignment
+		// and the variable is updated in place
+		if (index > 0 && !targets[index] &&
+			instructions[index - 1].type == Instruction::Type::PushSymbol &&
+			is(0, Instruction::Type::PushSymbol) &&
+			is(1, Instruction::Type::PushConstant) &&
+			is(2, Instruction::Type::Addition) &&
+			is(3, Instruction::Type::Assign) &&
+			instructions[index - 1].operand == instructions[index].operand)
+		{
+			return { 4, { Instruction::Type::AssignAddConstant, instructions[index + 1].operand } };
+		}
+
+		// An operator with a constant on the right side takes it right from the constant pool
+		if (is(0, Instruction::Type::PushConstant) && index + 1 < instructions.size() && !targets[index + 1])
+		{
+			const uint32_t constant = instructions[index].operand;
+
+			switch (instructions[index + 1].type)
+			{
+			case Instruction::Type::Addition:       return { 2, { Instruction::Type::AddConstant, constant } };
+			case Instruction::Type::Subtraction:    return { 2, { Instruction::Type::SubtractConstant, constant } };
+			case Instruction::Type::Multiplication: return { 2, { Instruction::Type::MultiplyConstant, constant } };
+			case Instruction::Type::Division:       return { 2, { Instruction::Type::DivideConstant, constant } };
+			}
+		}
+
+		// A comparison that only feeds a condition
+		if (is(0, Instruction::Type::Equals) && is(1, Instruction::Type::JumpIfFalse))
+			return { 2, { Instruction::Type::JumpIfNotEqual, instructions[index + 1].operand } };
+
+		return { 0, {} };
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "Program.hpp"
+
+namespace def
+{
+	// Peephole pass that fuses frequent sequences of instructions into superinstructions,
+	// each of them costs one dispatch instead of several
+	class Optimiser
+	{
+	public:
+		// Rewrites the instructions of the program, bodies of functions must be optimised separately
+		static void Optimise(Program& program);
+
+	private:
+		struct Fusion
+		{
+			// Number of instructions replaced, 0 if nothing matched
+			size_t length;
+			Instruction replacement;
+		};
+
+		static Fusion Match(const Program& program, const std::vector<bool>& targets, size_t index);
+	};
+}
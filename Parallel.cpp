@@ -0,0 +1,554 @@
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace def
+{
+	ParallelExecutor::ParallelExecutor(size_t threads)
+	{
+		threads = std::max<size_t>(threads, 1);
+
+		for (size_t i = 0; i < threads; i++)
+			m_Workers.push_back(std::make_unique<Interpreter>());
+
+		for (size_t i = 0; i < threads; i++)
+			m_Threads.emplace_back(&ParallelExecutor::Work, this, i);
+	}
+
+	ParallelExecutor::~ParallelExecutor()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stop = true;
+		}
+
+		m_Ready.notify_all();
+
+		for (auto& thread : m_Threads)
+			thread.join();
+	}
+
+	std::optional<Object> ParallelExecutor::Execute(Interpreter& interpreter, const Program& program)
+	{
+		std::vector<Statement> statements;
+
+		if (!Split(program, statements) || statements.size() < 2)
+			return interpreter.Execute(program);
+
+		// The limit applies to the sum of everything sequential execution holds at each point,
+		// workers can't reproduce where it's exceeded so limited interpreters run the program in order
+		if (interpreter.GetMemory().GetLimit() != MemoryTracker::UNLIMITED)
+			return interpreter.Execute(program);
+
+		// Every statement sees the same version of the shared variables, as one sequential run would
+		const auto shared = interpreter.GetSharedScope();
+		const auto frozen = shared ? std::make_shared<SharedScope>(shared->Acquire()) : nullptr;
+
+		// Workers read the globals of the interpreter in place, they change only between levels
+		for (auto& worker : m_Workers)
+		{
+			worker->SetSharedScope(frozen);
+			worker->SetFallback(&interpreter);
+		}
+
+		struct Restore
+		{
+			Interpreter& interpreter;
+			std::shared_ptr<SharedScope> scope;
+			std::vector<std::unique_ptr<Interpreter>>& workers;
+
+			~Restore()
+			{
+				interpreter.SetSharedScope(std::move(scope));
+
+				for (auto& worker : workers)
+					worker->SetFallback(nullptr);
+			}
+		} restore{ interpreter, shared, m_Workers };
+
+		interpreter.SetSharedScope(frozen);
+
+		// Host variables are shared with the application so only the interpreter touches them
+		for (auto& statement : statements)
+		{
+			for (const auto& name : statement.reads)
+				statement.barrier |= interpreter.IsBound(name);
+		}
+
+		// A statement goes to the level after the last writer of what it reads and not before
+		// the last reader or writer of what it writes, writes are committed only after the whole level
+		std::unordered_map<std::string, size_t> written, read;
+		size_t floor = 0, levels = 0;
+
+		for (auto& statement : statements)
+		{
+			if (statement.barrier)
+			{
+				statement.level = levels;
+				floor = levels + 1;
+			}
+			else
+			{
+				statement.level = floor;
+
+				for (const auto& name : statement.reads)
+				{
+					if (const auto it = written.find(name); it != written.end())
+						statement.level = std::max(statement.level, it->second + 1);
+				}
+
+				for (const auto& name : statement.writes)
+				{
+					if (const auto it = read.find(name); it != read.end())
+						statement.level = std::max(statement.level, it->second);
+				}
+
+				for (const auto& name : statement.reads)
+					read[name] = std::max(read[name], statement.level);
+
+				for (const auto& name : statement.writes)
+					written[name] = statement.level;
+			}
+
+			levels = std::max(levels, statement.level + 1);
+		}
+
+		std::vector<std::vector<size_t>> schedule(levels);
+
+		for (size_t i = 0; i < statements.size(); i++)
+			schedule[statements[i].level].push_back(i);
+
+		std::vector<Undo> undo;
+
+		for (const auto& level : schedule)
+		{
+			if (level.size() == 1 && statements[level.front()].barrier)
+			{
+				auto& statement = statements[level.front()];
+
+				try
+				{
+					statement.result = interpreter.Execute(statement.program);
+				}
+				catch (const Exception&)
+				{
+					statement.error = std::current_exception();
+				}
+
+				statement.executed = true;
+			}
+			else
+			{
+				// Small statements are grouped so a task is worth dispatching
+				const size_t tasks = std::min(level.size(), m_Workers.size() * 4);
+
+				std::vector<std::function<void(Interpreter&)>> work;
+
+				for (size_t task = 0; task < tasks; task++)
+				{
+					work.push_back([&, task](Interpreter& worker)
+						{
+							for (size_t i = task; i < level.size(); i += tasks)
+								Run(worker, statements[level[i]]);
+						});
+				}
+
+				Dispatch(work);
+			}
+
+			const auto failed = std::find_if(level.begin(), level.end(), [&](size_t index) { return statements[index].error != nullptr; });
+
+			if (failed == level.end())
+			{
+				for (const size_t index : level)
+					Commit(interpreter, statements, index, undo);
+
+				continue;
+			}
+
+			// Only statements up to the failed one would have run sequentially:
+			// the later ones are rolled back and the missing earlier ones run in order
+			const size_t error = *failed;
+
+			for (const size_t index : level)
+			{
+				if (index <= error)
+					Commit(interpreter, statements, index, undo);
+			}
+
+			Rollback(interpreter, undo, error);
+
+			for (size_t i = 0; i < error; i++)
+			{
+				if (statements[i].executed)
+					continue;
+
+				try
+				{
+					interpreter.Execute(statements[i].program);
+				}
+				catch (const Exception&)
+				{
+					// An earlier error wins so everything after it is rolled back as well
+					Rollback(interpreter, undo, i);
+					throw;
+				}
+			}
+
+			std::rethrow_exception(statements[error].error);
+		}
+
+		return std::move(statements.back().result);
+	}
+
+	void ParallelExecutor::Run(Interpreter& worker, Statement& statement)
+	{
+		try
+		{
+			// The worker starts empty, names the statement doesn't assign are read from the interpreter
+			worker.Reset();
+
+			statement.result = worker.Execute(statement.program);
+		}
+		catch (const Exception&)
+		{
+			statement.error = std::current_exception();
+		}
+
+		// A failed statement keeps the assignments it made before the error
+		for (const auto& name : statement.writes)
+		{
+			if (auto value = worker.TakeVariable(name))
+				statement.values.emplace_back(name, std::move(*value));
+		}
+
+		statement.executed = true;
+	}
+
+	void ParallelExecutor::Commit(Interpreter& interpreter, std::vector<Statement>& statements, size_t index, std::vector<Undo>& undo)
+	{
+		for (auto& [name, value] : statements[index].values)
+		{
+			// Values are moved, the previous one isn't needed until a rollback puts it back
+			undo.push_back({ index, name, interpreter.TakeVariable(name) });
+
+			interpreter.SetVariable(name, std::move(value));
+		}
+
+		statements[index].values.clear();
+	}
+
+	void ParallelExecutor::Rollback(Interpreter& interpreter, std::vector<Undo>& undo, size_t statement)
+	{
+		// Statements writing the same variable are committed in the program order
+		// so going backwards restores the value from before the earliest of them
+		for (auto it = undo.rbegin(); it != undo.rend(); it++)
+		{
+			if (it->statement <= statement)
+				continue;
+
+			if (it->value)
+				interpreter.SetVariable(it->name, std::move(it->value.value()));
+			else
+				interpreter.RemoveVariable(it->name);
+		}
+
+		std::erase_if(undo, [&](const Undo& entry) { return entry.statement > statement; });
+	}
+
+	bool ParallelExecutor::Split(const Program& program, std::vector<Statement>& statements)
+	{
+		// Statements are separated by Pop and nothing jumps over it
+		size_t begin = 0;
+
+		for (size_t i = 0; i <= program.instructions.size(); i++)
+		{
+			if (i < program.instructions.size() && program.instructions[i].type != Instruction::Type::Pop)
+				continue;
+
+			Statement statement;
+			statement.program = Extract(program, begin, i);
+
+			if (!Analyse(statement))
+				return false;
+
+			statements.push_back(std::move(statement));
+			begin = i + 1;
+		}
+
+		return true;
+	}
+
+	Program ParallelExecutor::Extract(const Program& program, size_t begin, size_t end)
+	{
+		Program statement;
+
+		// Only the constants, symbols and functions the statement uses are taken
+		std::unordered_map<uint32_t, uint32_t> constants, symbols, functions;
+
+		auto remap = [](std::unordered_map<uint32_t, uint32_t>& indices, uint32_t index, const auto& from, auto& to)
+			{
+				const auto [it, inserted] = indices.try_emplace(index, uint32_t(to.size()));
+
+				if (inserted)
+					to.push_back(from[index]);
+
+				return it->second;
+			};
+
+		for (size_t i = begin; i < end; i++)
+		{
+			Instruction instruction = program.instructions[i];
+
+			switch (instruction.type)
+			{
+			case Instruction::Type::PushConstant:
+			case Instruction::Type::AddConstant:
+			case Instruction::Type::SubtractConstant:
+			case Instruction::Type::MultiplyConstant:
+			case Instruction::Type::DivideConstant:
+			case Instruction::Type::AssignAddConstant:
+			case Instruction::Type::JumpIfNotEqualConstant:
+				instruction.operand = remap(constants, instruction.operand, program.constants, statement.constants);
+				break;
+
+			case Instruction::Type::PushSymbol:
+				instruction.operand = remap(symbols, instruction.operand, program.symbols, statement.symbols);
+				break;
+
+			case Instruction::Type::Define:
+				instruction.operand = remap(functions, instruction.operand, program.functions, statement.functions);
+				break;
+
+			case Instruction::Type::Jump:
+			case Instruction::Type::JumpIfFalse:
+			case Instruction::Type::JumpIfNotEqual:
+				instruction.operand -= uint32_t(begin);
+				break;
+			}
+
+			statement.instructions.push_back(instruction);
+			statement.offsets.push_back(i < program.offsets.size() ? program.offsets[i] : 0);
+		}
+
+		return statement;
+	}
+
+	bool ParallelExecutor::Analyse(Statement& statement)
+	{
+		const auto& instructions = statement.program.instructions;
+
+		for (const auto& symbol : statement.program.symbols)
+			statement.reads.push_back(std::get<Symbol>(symbol).value);
+
+		// Simulates the stack to find out which symbols are targets of assignments,
+		// every slot holds the pushed symbol or -1 for any other value
+		std::vector<int64_t> stack;
+
+		// Stacks at the targets of forward jumps
+		std::map<size_t, std::vector<int64_t>> targets;
+
+		bool reachable = true;
+
+		// Writes can't be found precisely so every mentioned symbol is treated as written
+		bool unknown = false;
+
+		auto pop = [&](size_t count)
+			{
+				if (stack.size() < count)
+					return false;
+
+				stack.resize(stack.size() - count);
+				return true;
+			};
+
+		auto write = [&](int64_t symbol)
+			{
+				if (symbol < 0)
+					unknown = true;
+				else
+					statement.writes.push_back(std::get<Symbol>(statement.program.symbols[symbol]).value);
+			};
+
+		for (size_t i = 0; i <= instructions.size(); i++)
+		{
+			if (const auto target = targets.find(i); target != targets.end())
+			{
+				if (!reachable)
+					stack = target->second;
+				else if (stack.size() != target->second.size())
+					return false;
+				else
+				{
+					// Branches may leave different values on the stack
+					for (size_t j = 0; j < stack.size(); j++)
+					{
+						if (stack[j] != target->second[j])
+							stack[j] = -1;
+					}
+				}
+
+				reachable = true;
+			}
+
+			if (i == instructions.size())
+				break;
+
+			if (!reachable)
+				return false;
+
+			const auto& instruction = instructions[i];
+
+			switch (instruction.type)
+			{
+			// The fused comparison has the stack effect of the push, its jump follows it
+			case Instruction::Type::PushConstant:
+			case Instruction::Type::PushLocal:
+			case Instruction::Type::JumpIfNotEqualConstant:
+				stack.push_back(-1);
+				break;
+
+			case Instruction::Type::PushSymbol:
+				stack.push_back(instruction.operand);
+				break;
+
+			case Instruction::Type::UnaryMinus:
+			case Instruction::Type::UnaryPlus:
+			case Instruction::Type::Length:
+			case Instruction::Type::AddConstant:
+			case Instruction::Type::SubtractConstant:
+			case Instruction::Type::MultiplyConstant:
+			case Instruction::Type::DivideConstant:
+				if (!pop(1))
+					return false;
+
+				stack.push_back(-1);
+				break;
+
+			case Instruction::Type::Subtraction:
+			case Instruction::Type::Addition:
+			case Instruction::Type::Multiplication:
+			case Instruction::Type::Division:
+			case Instruction::Type::Equals:
+			case Instruction::Type::Index:
+				if (!pop(2))
+					return false;
+
+				stack.push_back(-1);
+				break;
+
+			case Instruction::Type::Assign:
+			{
+				if (stack.size() < 2)
+					return false;
+
+				write(stack[stack.size() - 2]);
+
+				pop(2);
+				stack.push_back(-1);
+			}
+			break;
+
+			case Instruction::Type::AssignAddConstant:
+			{
+				if (stack.empty())
+					return false;
+
+				write(stack.back());
+				stack.back() = -1;
+			}
+			break;
+
+			case Instruction::Type::MakeArray:
+				if (!pop(instruction.operand))
+					return false;
+
+				stack.push_back(-1);
+				break;
+
+			case Instruction::Type::JumpIfFalse:
+			case Instruction::Type::JumpIfNotEqual:
+			case Instruction::Type::Jump:
+			{
+				const size_t count = instruction.type == Instruction::Type::JumpIfNotEqual ? 2 : instruction.type == Instruction::Type::JumpIfFalse ? 1 : 0;
+
+				// Only forward jumps are produced by the compiler
+				if (instruction.operand <= i || !pop(count) || targets.contains(instruction.operand))
+					return false;
+
+				targets[instruction.operand] = stack;
+				reachable = instruction.type != Instruction::Type::Jump;
+			}
+			break;
+
+			case Instruction::Type::Call:
+				// Functions can read and write any global variable
+				statement.barrier = true;
+
+				if (!pop(instruction.operand + 1))
+					return false;
+
+				stack.push_back(-1);
+				break;
+
+			case Instruction::Type::Define:
+			case Instruction::Type::While:
+			case Instruction::Type::For:
+				statement.barrier = true;
+				break;
+
+			default:
+				return false;
+			}
+		}
+
+		if (unknown)
+			statement.writes = statement.reads;
+
+		// The result of the statement is the only value it leaves
+		return stack.size() <= 1;
+	}
+
+	void ParallelExecutor::Dispatch(std::vector<std::function<void(Interpreter&)>>& tasks)
+	{
+		std::unique_lock lock(m_Mutex);
+
+		for (auto& task : tasks)
+			m_Tasks.push_back(std::move(task));
+
+		m_Pending += tasks.size();
+		m_Ready.notify_all();
+
+		m_Done.wait(lock, [this] { return m_Pending == 0; });
+	}
+
+	void ParallelExecutor::Work(size_t index)
+	{
+		Interpreter& worker = *m_Workers[index];
+
+		while (true)
+		{
+			std::function<void(Interpreter&)> task;
+
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Ready.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+
+				if (m_Stop)
+					return;
+
+				task = std::move(m_Tasks.front());
+				m_Tasks.pop_front();
+			}
+
+			task(worker);
+
+			std::lock_guard lock(m_Mutex);
+
+			if (--m_Pending == 0)
+				m_Done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Interpreter.hpp"
+
+namespace def
+{
+	// Runs top-level statements of a program on a thread pool. A statement waits only for the earlier
+	// statements whose variables it reads or writes, independent ones run at the same time on workers
+	// with their own interpreters and their writes are committed in the program order,
+	// so the variables, the result and the reported error are the same as with Interpreter::Execute
+	class ParallelExecutor
+	{
+	public:
+		ParallelExecutor(size_t threads = std::thread::hardware_concurrency());
+		~ParallelExecutor();
+
+	public:
+		// Statements that call or define functions or use host variables run on the interpreter itself
+		// after everything before them, programs that can't be analysed and interpreters with
+		// a memory limit run sequentially
+		std::optional<Object> Execute(Interpreter& interpreter, const Program& program);
+
+	private:
+		struct Statement
+		{
+			Program program;
+
+			// Every symbol the statement mentions and the ones it assigns
+			std::vector<std::string> reads;
+			std::vector<std::string> writes;
+
+			// Must run on the interpreter itself when everything before it is committed
+			bool barrier = false;
+
+			// Statements of the same level don't depend on each other
+			size_t level = 0;
+
+			bool executed = false;
+
+			std::optional<Object> result;
+			std::vector<std::pair<std::string, Object>> values;
+			std::exception_ptr error;
+		};
+
+		// The previous value of a variable a committed statement replaced, used to roll back on errors
+		struct Undo
+		{
+			size_t statement;
+			std::string name;
+			std::optional<Object> value;
+		};
+
+	private:
+		// Returns false if the program doesn't split into well-formed statements
+		static bool Split(const Program& program, std::vector<Statement>& statements);
+		static Program Extract(const Program& program, size_t begin, size_t end);
+		static bool Analyse(Statement& statement);
+
+		static void Run(Interpreter& worker, Statement& statement);
+		void Commit(Interpreter& interpreter, std::vector<Statement>& statements, size_t index, std::vector<Undo>& undo);
+
+		// Restores variables changed by the statements after the given one
+		static void Rollback(Interpreter& interpreter, std::vector<Undo>& undo, size_t statement);
+
+		// Runs the tasks on the workers and waits for all of them
+		void Dispatch(std::vector<std::function<void(Interpreter&)>>& tasks);
+		void Work(size_t index);
+
+	private:
+		std::vector<std::thread> m_Threads;
+		std::vector<std::unique_ptr<Interpreter>> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Ready;
+		std::condition_variable m_Done;
+
+		std::deque<std::function<void(Interpreter&)>> m_Tasks;
+		size_t m_Pending = 0;
+
+		bool m_Stop = false;
+
+	};
+}
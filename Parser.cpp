@@ -1,5 +1,9 @@
 #include "Parser.hpp"
 
+#include <charconv>
+#include <cstdint>
+#include <limits>
+
 namespace def
 {
 	Parser::Parser()
@@ -23,6 +27,7 @@ namespace def
 		auto StartToken = [&](Token::Type type, State nextState = State::CompleteToken, bool push = true)
 			{
 				token.type = type;
+				token.offset = currentChar - input.begin();
 
 				if (push)
 					token.value.push_back(*currentChar);
@@ -37,6 +42,90 @@ namespace def
 				currentChar++;
 			};
 
+		// Set after a digit separator (e.g. 1_000_000), the next character must be a digit
+		bool separated = false;
+
+		// Separators are skipped so the value keeps only the characters to decode
+		auto Separate = [&](const std::array<bool, 256>& digits)
+			{
+				if (*currentChar == '_')
+				{
+					if (separated || token.value.empty() || !digits[token.value.back()])
+						throw ParserException("Digit separators are allowed only between digits");
+
+					separated = true;
+					currentChar++;
+
+					return true;
+				}
+
+				if (separated && !digits[*currentChar])
+					throw ParserException("Digit separators are allowed only between digits");
+
+				separated = false;
+
+				return false;
+			};
+
+		// Numeric literals are decoded once here so the compiler only copies the value
+		auto CompleteNumber = [&]()
+			{
+				if (separated)
+					throw ParserException("Digit separators are allowed only between digits");
+
+				const char* first = token.value.data();
+				const char* last = first + token.value.size();
+
+				std::from_chars_result result{};
+
+				if (token.type == Token::Type::Literal_NumericBase10)
+				{
+					if (DecodeDecimal(token.value, token.number))
+					{
+						stateNext = State::CompleteToken;
+						return;
+					}
+
+					result = std::from_chars(first, last, token.number);
+				}
+				else
+				{
+					const int base =
+						token.type == Token::Type::Literal_NumericBase16 ? 16 :
+						token.type == Token::Type::Literal_NumericBase8 ? 8 : 2;
+
+					uint64_t integer = 0;
+					result = std::from_chars(first, last, integer, base);
+					token.number = (long double)integer;
+				}
+
+				if (result.ec == std::errc::result_out_of_range)
+					throw ParserException("Numeric literal is out of range: " + token.value);
+
+				// Also catches empty literals (e.g. 0x) and misplaced points or exponents (e.g. 1.2.3 or 1e)
+				if (result.ec != std::errc() || result.ptr != last)
+					throw ParserException("Invalid numeric literal: " + token.value);
+
+				stateNext = State::CompleteToken;
+			};
+
+		auto ReadDigits = [&](const std::array<bool, 256>& digits, State nextState)
+			{
+				if (Separate(digits))
+					return;
+
+				if (digits[*currentChar])
+					AppendChar(nextState);
+				else
+				{
+					// Something has occured in the number (e.g. 531abc14124 or 0b102)
+					if (guard::Symbols[*currentChar])
+						throw ParserException("Invalid numeric literal or symbol");
+
+					CompleteNumber();
+				}
+			};
+
 		while (currentChar != input.end())
 		{
 			// FDA - First Digit Analysis
@@ -109,8 +198,15 @@ namespace def
 				{
 				case State::Literal_NumericBase10:
 				{
-					// Check for continuation of numeric literal
-					if (guard::Digits[*currentChar])
+					// Read decimal number with an optional fraction and exponent (e.g. 12, 0.5 or 1.5e-3)
+
+					if (Separate(guard::DecDigits))
+						break;
+
+					// The sign belongs to the number only right after the exponent
+					const bool sign = guard::Signs[*currentChar] && guard::Exponents[token.value.back()];
+
+					if (guard::Digits[*currentChar] || guard::Exponents[*currentChar] || sign)
 						AppendChar(State::Literal_NumericBase10);
 					else
 					{
@@ -118,7 +214,7 @@ namespace def
 						if (guard::Symbols[*currentChar])
 							throw ParserException("Invalid numeric literal or symbol");
 
-						stateNext = State::CompleteToken;
+						CompleteNumber();
 					}
 				}
 				break;
@@ -135,6 +231,12 @@ namespace def
 							stateNext = State::Literal_NumericBase16;
 						}
 
+						else if (*currentChar == 'o' || *currentChar == 'O')
+						{
+							token.type = Token::Type::Literal_NumericBase8;
+							stateNext = State::Literal_NumericBase8;
+						}
+
 						else if (*currentChar == 'b' || *currentChar == 'B')
 						{
 							token.type = Token::Type::Literal_NumericBase2;
@@ -143,40 +245,36 @@ namespace def
 
 						currentChar++;
 					}
-					else
+					else if (guard::Symbols[*currentChar] && !guard::Digits[*currentChar] && !guard::Exponents[*currentChar] && *currentChar != '_')
 						throw ParserException("Unknown prefix for numeric literal");
+					else
+					{
+						// It's just a decimal number that starts with zero (e.g. 0, 0.5, 0e3 or 0_1)
+						token.type = Token::Type::Literal_NumericBase10;
+						token.value = "0";
+						stateNext = State::Literal_NumericBase10;
+					}
 				}
 				break;
 
 				case State::Literal_NumericBase16:
 				{
 					// Read hexadecimal number
+					ReadDigits(guard::HexDigits, State::Literal_NumericBase16);
+				}
+				break;
 
-					if (guard::HexDigits[*currentChar])
-						AppendChar(State::Literal_NumericBase16);
-					else
-					{
-						if (guard::Symbols[*currentChar])
-							throw ParserException("Invalid numeric literal or symbol");
-
-						stateNext = State::CompleteToken;
-					}
+				case State::Literal_NumericBase8:
+				{
+					// Read octal number
+					ReadDigits(guard::OctDigits, State::Literal_NumericBase8);
 				}
 				break;
 
 				case State::Literal_NumericBase2:
 				{
 					// Read binary number
-
-					if (guard::HexDigits[*currentChar])
-						AppendChar(State::Literal_NumericBase2);
-					else
-					{
-						if (guard::Symbols[*currentChar])
-							throw ParserException("Invalid numeric literal or symbol");
-
-						stateNext = State::CompleteToken;
-					}
+					ReadDigits(guard::BinDigits, State::Literal_NumericBase2);
 				}
 				break;
 
@@ -277,11 +375,130 @@ namespace def
 		if (quotesBalancer != 0)
 			throw ParserException("Quotes were not balanced");
 
+		// A single zero at the end of the input
+		if (stateNow == State::Literal_NumericBaseUnknown)
+		{
+			token.type = Token::Type::Literal_NumericBase10;
+			token.value = "0";
+			stateNow = State::Literal_NumericBase10;
+		}
+
+		// The input ends with a numeric literal
+		if (stateNow == State::Literal_NumericBase16 || stateNow == State::Literal_NumericBase10 ||
+			stateNow == State::Literal_NumericBase8 || stateNow == State::Literal_NumericBase2)
+		{
+			CompleteNumber();
+		}
+
 		// Drain out the last token
 		if (!token.value.empty())
 			tokens.push_back(token);
 	}
 
+	bool Parser::DecodeDecimal(std::string_view text, long double& value)
+	{
+		// Both the digits and the power of ten are exact so the value is rounded only once, by the
+		// division or the multiplication, and matches std::from_chars which is much slower for long double
+		static constexpr int MAX_POWER = 22;
+		static constexpr auto s_Powers = []()
+			{
+				std::array<long double, MAX_POWER + 1> powers{ 1.0L };
+
+				for (size_t i = 1; i < powers.size(); i++)
+					powers[i] = powers[i - 1] * 10;
+
+				return powers;
+			}();
+
+		uint64_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool point = false, any = false;
+
+		size_t i = 0;
+
+		for (; i < text.size(); i++)
+		{
+			if (text[i] == '.')
+			{
+				if (point)
+					return false;
+
+				point = true;
+				continue;
+			}
+
+			if (!guard::DecDigits[text[i]])
+				break;
+
+			any = true;
+
+			// Leading zeros don't count as significant digits
+			if (mantissa == 0 && text[i] == '0')
+			{
+				if (point)
+					exponent--;
+
+				continue;
+			}
+
+			if (++digits > std::numeric_limits<uint64_t>::digits10)
+				return false;
+
+			mantissa = mantissa * 10 + (text[i] - '0');
+
+			if (point)
+				exponent--;
+		}
+
+		if (!any)
+			return false;
+
+		if (i < text.size())
+		{
+			if (!guard::Exponents[text[i++]])
+				return false;
+
+			const bool negative = i < text.size() && text[i] == '-';
+
+			if (i < text.size() && guard::Signs[text[i]])
+				i++;
+
+			if (i == text.size())
+				return false;
+
+			int power = 0;
+
+			for (; i < text.size(); i++)
+			{
+				if (!guard::DecDigits[text[i]] || power > MAX_POWER * 100)
+					return false;
+
+				power = power * 10 + (text[i] - '0');
+			}
+
+			exponent += negative ? -power : power;
+		}
+
+		if (mantissa == 0)
+		{
+			value = 0;
+			return true;
+		}
+
+		if constexpr (std::numeric_limits<long double>::digits < std::numeric_limits<uint64_t>::digits)
+		{
+			if (mantissa >> std::numeric_limits<long double>::digits)
+				return false;
+		}
+
+		if (exponent < -MAX_POWER || exponent > MAX_POWER)
+			return false;
+
+		value = exponent < 0 ? (long double)mantissa / s_Powers[-exponent] : (long double)mantissa * s_Powers[exponent];
+
+		return true;
+	}
+
 	std::unordered_map<std::string, Operator> Parser::s_Operators =
 	{
 		{"=", { Operator::Type::Assign, 0, 2 } },
@@ -294,12 +511,13 @@ namespace def
 		// Unary operators (in that way they are easier to handle)
 		{"u-", { Operator::Type::Subtraction, Operator::MAX_PRECEDENCE, 1 } },
 		{"u+", { Operator::Type::Addition, Operator::MAX_PRECEDENCE, 1 } },
+		{"#", { Operator::Type::Length, Operator::MAX_PRECEDENCE, 1 } },
 	};
 
 	std::unordered_map<std::string, Keyword> Parser::s_Keywords =
 	{
-		{ "if", {} },
-		{ "while", {} },
-		{ "for", {} }
+		{ "if", { Keyword::Type::If } },
+		{ "while", { Keyword::Type::While } },
+		{ "for", { Keyword::Type::For } }
 	};
 }
@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <string>
 #include <list>
+#include <string_view>
 
 #include "Operator.hpp"
 #include "Token.hpp"
@@ -34,6 +35,9 @@ namespace def
 
 		void Tokenise(std::string_view input, std::vector<Token>& tokens);
 
+		// Decodes short decimal literals exactly without a library call, returns false for the rest
+		static bool DecodeDecimal(std::string_view text, long double& value);
+
 	public:
 		static std::unordered_map<std::string, Operator> s_Operators;
 		static std::unordered_map<std::string, Keyword> s_Keywords;
@@ -0,0 +1,52 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+namespace def
+{
+	std::vector<Profiler::Pair> Profiler::GetPairs() const
+	{
+		std::vector<Pair> pairs;
+
+		for (size_t first = 0; first < OPCODES; first++)
+		{
+			for (size_t second = 0; second < OPCODES; second++)
+			{
+				if (m_Pairs[first][second] > 0)
+					pairs.push_back({ Instruction::Type(first), Instruction::Type(second), m_Pairs[first][second] });
+			}
+		}
+
+		std::stable_sort(pairs.begin(), pairs.end(), [](const Pair& lhs, const Pair& rhs) { return lhs.count > rhs.count; });
+
+		return pairs;
+	}
+
+	uint64_t Profiler::GetDispatches() const
+	{
+		return m_Dispatches;
+	}
+
+	void Profiler::Clear()
+	{
+		m_Pairs = {};
+		m_Previous = Instruction::Type::Pop;
+		m_Dispatches = 0;
+	}
+
+	std::string Profiler::ToString(size_t top) const
+	{
+		std::string result = "Dispatches: " + std::to_string(m_Dispatches) + "\n";
+
+		const auto pairs = GetPairs();
+
+		for (size_t i = 0; i < std::min(top, pairs.size()); i++)
+		{
+			result += std::string(Instruction::GetTag(pairs[i].first));
+			result += std::string(Instruction::GetTag(pairs[i].second));
+			result += std::to_string(pairs[i].count) + "\n";
+		}
+
+		return result;
+	}
+}
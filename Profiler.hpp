@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "Program.hpp"
+
+namespace def
+{
+	// Counts how often every opcode follows another one during execution,
+	// frequent pairs are candidates for superinstructions
+	class Profiler
+	{
+	public:
+		struct Pair
+		{
+			Instruction::Type first;
+			Instruction::Type second;
+			uint64_t count;
+		};
+
+	public:
+		void Record(Instruction::Type type)
+		{
+			m_Pairs[size_t(m_Previous)][size_t(type)]++;
+			m_Previous = type;
+			m_Dispatches++;
+		}
+
+		// Pairs sorted from the most frequent one, pairs that never occurred are skipped
+		std::vector<Pair> GetPairs() const;
+
+		uint64_t GetDispatches() const;
+
+		void Clear();
+
+		std::string ToString(size_t top = 20) const;
+
+	private:
+		static constexpr size_t OPCODES = size_t(Instruction::Type::For) + 1;
+
+		std::array<std::array<uint64_t, OPCODES>, OPCODES> m_Pairs{};
+
+		// The first instruction is counted as if it followed Pop
+		Instruction::Type m_Previous = Instruction::Type::Pop;
+
+		uint64_t m_Dispatches = 0;
+
+	};
+}
@@ -0,0 +1,405 @@
+#include "Program.hpp"
+#include "Serialiser.hpp"
+
+#include <algorithm>
+
+namespace def
+{
+	InlineCache::InlineCache(const InlineCache& other) : m_Type(other.Get())
+	{
+	}
+
+	InlineCache& InlineCache::operator=(const InlineCache& other)
+	{
+		Set(other.Get());
+		return *this;
+	}
+
+	InlineCache::Type InlineCache::Get() const
+	{
+		return m_Type.load(std::memory_order_relaxed);
+	}
+
+	void InlineCache::Set(Type type)
+	{
+		m_Type.store(type, std::memory_order_relaxed);
+	}
+
+	std::string_view Instruction::GetTag(Type type)
+	{
+		switch (type)
+		{
+		case Type::PushConstant:      return "[Push, Constant      ] ";
+		case Type::PushSymbol:        return "[Push, Symbol        ] ";
+		case Type::UnaryMinus:        return "[Unary, Minus        ] ";
+		case Type::UnaryPlus:         return "[Unary, Plus         ] ";
+		case Type::Subtraction:       return "[Subtraction         ] ";
+		case Type::Addition:          return "[Addition            ] ";
+		case Type::Multiplication:    return "[Multiplication      ] ";
+		case Type::Division:          return "[Division            ] ";
+		case Type::Equals:            return "[Equals              ] ";
+		case Type::Assign:            return "[Assign              ] ";
+		case Type::MakeArray:         return "[Make, Array         ] ";
+		case Type::Index:             return "[Index               ] ";
+		case Type::Length:            return "[Length              ] ";
+		case Type::Call:              return "[Call                ] ";
+		case Type::PushLocal:         return "[Push, Local         ] ";
+		case Type::Jump:              return "[Jump                ] ";
+		case Type::JumpIfFalse:       return "[Jump, If False      ] ";
+		case Type::Define:            return "[Define              ] ";
+		case Type::Return:            return "[Return              ] ";
+		case Type::AddConstant:       return "[Add, Constant       ] ";
+		case Type::SubtractConstant:  return "[Subtract, Constant  ] ";
+		case Type::MultiplyConstant:  return "[Multiply, Constant  ] ";
+		case Type::DivideConstant:    return "[Divide, Constant    ] ";
+		case Type::AssignAddConstant: return "[Assign, Add Constant] ";
+		case Type::JumpIfNotEqual:    return "[Jump, If Not Equal  ] ";
+		case Type::JumpIfNotEqualConstant: return "[Jump, If Not Const  ] ";
+		case Type::Pop:               return "[Pop                 ] ";
+		case Type::While:             return "[Keyword, While      ] ";
+		case Type::For:               return "[Keyword, For        ] ";
+		}
+
+		return "";
+	}
+
+	std::string Instruction::ToString() const
+	{
+		const std::string tag(GetTag(type));
+
+		switch (type)
+		{
+		case Type::PushConstant:
+		case Type::PushSymbol:
+		case Type::MakeArray:
+		case Type::Call:
+		case Type::PushLocal:
+		case Type::Jump:
+		case Type::JumpIfFalse:
+		case Type::Define:
+		case Type::AddConstant:
+		case Type::SubtractConstant:
+		case Type::MultiplyConstant:
+		case Type::DivideConstant:
+		case Type::AssignAddConstant:
+		case Type::JumpIfNotEqual:
+		case Type::JumpIfNotEqualConstant: return tag + std::to_string(operand);
+		}
+
+		return tag;
+	}
+
+	static constexpr uint32_t FORMAT_MAGIC = 0x43464544; // "DEFC"
+
+	bool Program::Save(const std::string& path, uint64_t checksum) const
+	{
+		// The string table is written before everything else
+		// so it's filled while the body is being written
+		StringTable strings;
+		BinaryWriter body;
+
+		Write(body, strings);
+
+		BinaryWriter writer;
+
+		writer.Write(FORMAT_MAGIC);
+		writer.Write(FORMAT_VERSION);
+		writer.Write(uint8_t(sizeof(long double)));
+		writer.Write(checksum);
+
+		strings.Write(writer);
+		writer.Append(body);
+
+		return writer.Save(path);
+	}
+
+	bool Program::Load(const std::string& path, std::optional<uint64_t> checksum)
+	{
+		BinaryReader reader;
+
+		if (!reader.Open(path))
+			return false;
+
+		try
+		{
+			if (reader.Read<uint32_t>() != FORMAT_MAGIC || reader.Read<uint32_t>() != FORMAT_VERSION)
+				return false;
+
+			if (reader.Read<uint8_t>() != sizeof(long double))
+				return false;
+
+			const uint64_t sourceChecksum = reader.Read<uint64_t>();
+
+			if (checksum && sourceChecksum != checksum.value())
+				return false;
+
+			StringTable strings;
+			strings.Read(reader);
+
+			if (!Read(reader, strings, 0) || !reader.IsEnd())
+				return false;
+
+			// Only function bodies return, the top level has no caller to go back to
+			return std::none_of(instructions.begin(), instructions.end(),
+				[](const Instruction& instruction) { return instruction.type == Instruction::Type::Return; });
+		}
+		catch (const Exception&)
+		{
+			// The file is truncated or corrupted
+			return false;
+		}
+	}
+
+	void Program::Write(BinaryWriter& writer, StringTable& strings) const
+	{
+		writer.Write(uint32_t(symbols.size()));
+
+		for (const auto& symbol : symbols)
+			writer.Write(strings.Intern(std::get<Symbol>(symbol).value));
+
+		writer.Write(uint32_t(constants.size()));
+
+		for (const auto& constant : constants)
+			WriteObject(writer, strings, constant);
+
+		// Bodies of functions are nested programs
+		writer.Write(uint32_t(functions.size()));
+
+		for (const auto& function : functions)
+		{
+			writer.Write(strings.Intern(function.name));
+			writer.Write(function.arity);
+
+			function.body->Write(writer, strings);
+		}
+
+		writer.Write(uint32_t(instructions.size()));
+
+		for (size_t i = 0; i < instructions.size(); i++)
+		{
+			writer.Write(uint8_t(instructions[i].type));
+			writer.Write(instructions[i].operand);
+			writer.Write(i < offsets.size() ? offsets[i] : 0u);
+		}
+	}
+
+	bool Program::Read(BinaryReader& reader, const StringTable& strings, uint32_t locals)
+	{
+		// Counts are checked against the smallest encoding of an element (e.g. a boolean constant
+		// or a function with an empty body) so a corrupted file can't cause a huge allocation
+		symbols.resize(reader.ReadCount(sizeof(uint32_t)));
+
+		for (auto& symbol : symbols)
+			symbol = Symbol{ std::string(strings.Get(reader.Read<uint32_t>())) };
+
+		constants.resize(reader.ReadCount(2 * sizeof(uint8_t)));
+
+		for (auto& constant : constants)
+			constant = ReadObject(reader, strings);
+
+		functions.resize(reader.ReadCount(6 * sizeof(uint32_t)));
+
+		for (auto& function : functions)
+		{
+			function.name = strings.Get(reader.Read<uint32_t>());
+			function.arity = reader.Read<uint32_t>();
+
+			auto body = std::make_shared<Program>();
+
+			// A body must always give the control back to the caller
+			if (!body->Read(reader, strings, function.arity) || body->instructions.empty() || body->instructions.back().type != Instruction::Type::Return)
+				return false;
+
+			function.body = std::move(body);
+		}
+
+		instructions.resize(reader.ReadCount(sizeof(uint8_t) + 2 * sizeof(uint32_t)));
+		offsets.resize(instructions.size());
+
+		for (size_t i = 0; i < instructions.size(); i++)
+		{
+			instructions[i].type = Instruction::Type(reader.Read<uint8_t>());
+			instructions[i].operand = reader.Read<uint32_t>();
+			offsets[i] = reader.Read<uint32_t>();
+		}
+
+		// Operands are used as indices without checks during execution
+		for (const auto& instruction : instructions)
+		{
+			switch (instruction.type)
+			{
+			case Instruction::Type::PushConstant:
+			case Instruction::Type::AddConstant:
+			case Instruction::Type::SubtractConstant:
+			case Instruction::Type::MultiplyConstant:
+			case Instruction::Type::DivideConstant:
+			case Instruction::Type::AssignAddConstant:
+				if (instruction.operand >= constants.size())
+					return false;
+				break;
+
+			case Instruction::Type::JumpIfNotEqualConstant:
+				if (instruction.operand >= constants.size() || &instruction == &instructions.back() || (&instruction + 1)->type != Instruction::Type::JumpIfNotEqual)
+					return false;
+				break;
+
+			case Instruction::Type::PushSymbol:
+				if (instruction.operand >= symbols.size())
+					return false;
+				break;
+
+			case Instruction::Type::PushLocal:
+				if (instruction.operand >= locals)
+					return false;
+				break;
+
+			case Instruction::Type::Define:
+				if (instruction.operand >= functions.size())
+					return false;
+				break;
+
+			case Instruction::Type::Jump:
+			case Instruction::Type::JumpIfFalse:
+			case Instruction::Type::JumpIfNotEqual:
+				if (instruction.operand > instructions.size())
+					return false;
+				break;
+
+			default:
+				if (instruction.type > Instruction::Type::For)
+					return false;
+				break;
+			}
+		}
+
+		return CheckStack(locals);
+	}
+
+	bool Program::CheckStack(uint32_t locals) const
+	{
+		// Height of the stack above the frame base before every instruction, -1 until a path reaches it
+		std::vector<int64_t> heights(instructions.size() + 1, -1);
+		std::vector<size_t> pending;
+
+		// Paths that meet must leave the same number of values
+		auto reach = [&](size_t target, int64_t height)
+			{
+				if (heights[target] == -1)
+				{
+					heights[target] = height;
+					pending.push_back(target);
+				}
+
+				return heights[target] == height;
+			};
+
+		reach(0, locals);
+
+		while (!pending.empty())
+		{
+			const size_t i = pending.back();
+			pending.pop_back();
+
+			if (i == instructions.size())
+				continue;
+
+			const auto& instruction = instructions[i];
+
+			// Values the instruction takes and leaves, the arguments of a function are its first values
+			int64_t takes = 0, leaves = 0;
+
+			switch (instruction.type)
+			{
+			case Instruction::Type::PushConstant:
+			case Instruction::Type::PushSymbol:
+			case Instruction::Type::JumpIfNotEqualConstant:
+				leaves = 1;
+				break;
+
+			case Instruction::Type::PushLocal:
+				// The local is copied so it must still be on the stack
+				takes = int64_t(instruction.operand) + 1;
+				leaves = takes + 1;
+				break;
+
+			case Instruction::Type::UnaryMinus:
+			case Instruction::Type::UnaryPlus:
+			case Instruction::Type::Length:
+			case Instruction::Type::AddConstant:
+			case Instruction::Type::SubtractConstant:
+			case Instruction::Type::MultiplyConstant:
+			case Instruction::Type::DivideConstant:
+			case Instruction::Type::AssignAddConstant:
+				takes = leaves = 1;
+				break;
+
+			case Instruction::Type::Subtraction:
+			case Instruction::Type::Addition:
+			case Instruction::Type::Multiplication:
+			case Instruction::Type::Division:
+			case Instruction::Type::Equals:
+			case Instruction::Type::Assign:
+			case Instruction::Type::Index:
+				takes = 2;
+				leaves = 1;
+				break;
+
+			case Instruction::Type::MakeArray:
+				takes = instruction.operand;
+				leaves = 1;
+				break;
+
+			case Instruction::Type::Call:
+				takes = int64_t(instruction.operand) + 1;
+				leaves = 1;
+				break;
+
+			case Instruction::Type::JumpIfFalse:
+				takes = 1;
+				break;
+
+			case Instruction::Type::JumpIfNotEqual:
+				takes = 2;
+				break;
+
+			case Instruction::Type::Return:
+				takes = 1;
+				break;
+
+			case Instruction::Type::Pop:
+				// Nothing is popped from an empty frame
+				takes = std::min<int64_t>(heights[i], 1);
+				break;
+			}
+
+			if (heights[i] < takes)
+				return false;
+
+			const int64_t height = heights[i] - takes + leaves;
+
+			switch (instruction.type)
+			{
+			case Instruction::Type::Return:
+				break;
+
+			case Instruction::Type::Jump:
+				if (!reach(instruction.operand, height))
+					return false;
+				break;
+
+			case Instruction::Type::JumpIfFalse:
+			case Instruction::Type::JumpIfNotEqual:
+				if (!reach(instruction.operand, height) || !reach(i + 1, height))
+					return false;
+				break;
+
+			default:
+				if (!reach(i + 1, height))
+					return false;
+				break;
+			}
+		}
+
+		return true;
+	}
+}
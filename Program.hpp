@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <optional>
+#include <memory>
+#include <atomic>
+
+#include "Scope.hpp"
+
+namespace def
+{
+	// Types of the operands an operator site saw last time, programs are shared between
+	// interpreters on different threads so it's a relaxed atomic and a race only costs a miss
+	class InlineCache
+	{
+	public:
+		enum class Type : uint8_t
+		{
+			Empty,
+			Numbers,
+			Strings,
+			Booleans,
+			Generic
+		};
+
+	public:
+		InlineCache() = default;
+		InlineCache(const InlineCache& other);
+
+		InlineCache& operator=(const InlineCache& other);
+
+	public:
+		Type Get() const;
+		void Set(Type type);
+
+	private:
+		std::atomic<Type> m_Type = Type::Empty;
+
+	};
+
+	struct Instruction
+	{
+		enum class Type : uint8_t
+		{
+			PushConstant,
+			PushSymbol,
+			UnaryMinus,
+			UnaryPlus,
+			Subtraction,
+			Addition,
+			Multiplication,
+			Division,
+			Equals,
+			Assign,
+			MakeArray,
+			Index,
+			Length,
+			Call,
+			PushLocal,
+			Jump,
+			JumpIfFalse,
+			Define,
+			Return,
+
+			// Superinstructions produced by the Optimiser, the operand is a constant index
+			// or a target of the jump
+			AddConstant,
+			SubtractConstant,
+			MultiplyConstant,
+			DivideConstant,
+			AssignAddConstant,
+			JumpIfNotEqual,
+
+			// Takes the place of PushConstant before JumpIfNotEqual, it compares the value
+			// with the constant and jumps to the target of the next instruction, which isn't dispatched
+			JumpIfNotEqualConstant,
+
+			Pop,
+			While,
+			For
+		};
+
+		Type type;
+
+		// Index into the constant pool, the symbol table, the function table or a local slot,
+		// number of array elements or call arguments, or a target of a jump
+		uint32_t operand = 0;
+
+		// Only used by operators, it isn't serialised
+		mutable InlineCache cache{};
+
+		std::string ToString() const;
+
+		// Name of the instruction without the operand
+		static std::string_view GetTag(Type type);
+	};
+
+	struct Program;
+
+	class BinaryWriter;
+	class BinaryReader;
+	class StringTable;
+
+	struct Function
+	{
+		std::string name;
+		uint32_t arity = 0;
+
+		// Arguments are the first local slots of the call frame
+		std::shared_ptr<const Program> body;
+	};
+
+	// The result of compiling a sequence of tokens,
+	// it's immutable after compilation so it can be shared between interpreters
+	struct Program
+	{
+		std::vector<Instruction> instructions;
+		std::vector<Object> constants;
+
+		// Names are stored as Symbol objects so they can be pushed by reference
+		std::vector<Object> symbols;
+
+		// Functions defined by the program
+		std::vector<Function> functions;
+
+		// Source offset of the token that produced each instruction
+		std::vector<uint32_t> offsets;
+
+		// Must be increased whenever the layout of .defc files changes
+		static constexpr uint32_t FORMAT_VERSION = 6;
+
+		// Writes the program into a .defc file, the checksum identifies the source it was compiled from
+		bool Save(const std::string& path, uint64_t checksum) const;
+
+		// Returns false if the file can't be read, was written by another version
+		// or (if the checksum is given) was compiled from a different source
+		bool Load(const std::string& path, std::optional<uint64_t> checksum = std::nullopt);
+
+	private:
+		void Write(BinaryWriter& writer, StringTable& strings) const;
+		bool Read(BinaryReader& reader, const StringTable& strings, uint32_t locals);
+
+		// Returns false if some path consumes values below the frame base (e.g. the arguments
+		// of a corrupted file take the caller's values) so loaded programs need no checks at run time
+		bool CheckStack(uint32_t locals) const;
+	};
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace def
+{
+	// Bounded lock-free queue for exactly one producer thread and one consumer thread,
+	// the capacity is rounded up to a power of two
+	template <class T>
+	class SpscQueue
+	{
+	public:
+		SpscQueue(size_t capacity = 64)
+		{
+			size_t size = 2;
+
+			while (size < capacity)
+				size *= 2;
+
+			m_Mask = size - 1;
+			m_Slots = std::make_unique<T[]>(size);
+		}
+
+	public:
+		bool TryPush(T& value)
+		{
+			const size_t tail = m_Tail.load(std::memory_order_relaxed);
+
+			if (tail - m_Head.load(std::memory_order_acquire) > m_Mask)
+				return false;
+
+			m_Slots[tail & m_Mask] = std::move(value);
+			m_Tail.store(tail + 1, std::memory_order_release);
+
+			Wake(m_Tail, m_ConsumerWaiting);
+
+			return true;
+		}
+
+		bool TryPop(T& value)
+		{
+			const size_t head = m_Head.load(std::memory_order_relaxed);
+
+			if (head == m_Tail.load(std::memory_order_acquire))
+				return false;
+
+			value = std::move(m_Slots[head & m_Mask]);
+			m_Head.store(head + 1, std::memory_order_release);
+
+			Wake(m_Head, m_ProducerWaiting);
+
+			return true;
+		}
+
+		// Blocking versions spin for a while and then sleep until the other side moves its index
+		void Push(T value)
+		{
+			for (size_t spins = 0;; spins++)
+			{
+				const size_t head = m_Head.load(std::memory_order_acquire);
+
+				if (TryPush(value))
+					return;
+
+				if (spins >= SPINS)
+					Wait(m_Head, head, m_ProducerWaiting);
+			}
+		}
+
+		T Pop()
+		{
+			T value;
+
+			for (size_t spins = 0;; spins++)
+			{
+				const size_t tail = m_Tail.load(std::memory_order_acquire);
+
+				if (TryPop(value))
+					return value;
+
+				if (spins >= SPINS)
+					Wait(m_Tail, tail, m_ConsumerWaiting);
+			}
+		}
+
+	private:
+		static constexpr size_t SPINS = 64;
+
+		// The fences pair up: either the waiter sees the new index and doesn't sleep
+		// or the other side sees the flag and wakes it up
+		static void Wait(std::atomic<size_t>& index, size_t seen, std::atomic<bool>& waiting)
+		{
+			waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			index.wait(seen, std::memory_order_acquire);
+
+			waiting.store(false, std::memory_order_relaxed);
+		}
+
+		static void Wake(std::atomic<size_t>& index, const std::atomic<bool>& waiting)
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (waiting.load(std::memory_order_relaxed))
+				index.notify_one();
+		}
+
+	private:
+		std::unique_ptr<T[]> m_Slots;
+		size_t m_Mask;
+
+		// The producer and the consumer write different cache lines,
+		// each side keeps its flag next to its index
+		alignas(64) std::atomic<size_t> m_Head = 0;
+		std::atomic<bool> m_ConsumerWaiting = false;
+
+		alignas(64) std::atomic<size_t> m_Tail = 0;
+		std::atomic<bool> m_ProducerWaiting = false;
+
+	};
+}
@@ -0,0 +1,145 @@
+#include "Scheduler.hpp"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace def
+{
+	// CPU time of the calling thread, it stands still while the thread is preempted or waits
+	static std::chrono::nanoseconds ThreadTime()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+
+		// Both times are in 100 ns units
+		auto ticks = [](const FILETIME& time) { return (uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+
+		return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+#else
+		timespec time{};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+		return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#endif
+	}
+
+	Script::Script(std::shared_ptr<Interpreter> interpreter, std::shared_ptr<const Program> program)
+		: interpreter(std::move(interpreter)), program(std::move(program)), continuation(*this->program)
+	{
+	}
+
+	Scheduler::Scheduler(size_t threads, size_t budget) : m_Budget(std::max<size_t>(budget, 1))
+	{
+		threads = std::max<size_t>(threads, 1);
+
+		for (size_t i = 0; i < threads; i++)
+			m_Threads.emplace_back(&Scheduler::Work, this);
+	}
+
+	Scheduler::~Scheduler()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stop = true;
+		}
+
+		m_Ready.notify_all();
+
+		for (auto& thread : m_Threads)
+			thread.join();
+	}
+
+	std::shared_ptr<Script> Scheduler::Submit(std::shared_ptr<Interpreter> interpreter, std::shared_ptr<const Program> program)
+	{
+		auto script = std::make_shared<Script>(std::move(interpreter), std::move(program));
+
+		{
+			std::lock_guard lock(m_Mutex);
+
+			m_Queue.push_back(script);
+			m_Active++;
+		}
+
+		m_Ready.notify_one();
+
+		return script;
+	}
+
+	void Scheduler::Wait()
+	{
+		std::unique_lock lock(m_Mutex);
+		m_Done.wait(lock, [this] { return m_Active == 0; });
+	}
+
+	void Scheduler::Work()
+	{
+		while (true)
+		{
+			std::shared_ptr<Script> script;
+
+			{
+				std::unique_lock lock(m_Mutex);
+				m_Ready.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+
+				if (m_Stop)
+					return;
+
+				script = std::move(m_Queue.front());
+				m_Queue.pop_front();
+			}
+
+			script->state = Script::State::Running;
+
+			bool finished = true;
+			Script::State state = Script::State::Failed;
+
+			const auto start = ThreadTime();
+
+			try
+			{
+				finished = script->interpreter->Resume(script->continuation, m_Budget);
+				state = finished ? Script::State::Finished : Script::State::Waiting;
+			}
+			catch (const std::exception& e)
+			{
+				// Native functions may throw anything, the worker must survive it and count the script as done
+				script->error = e.what();
+			}
+			catch (...)
+			{
+				script->error = "Unknown error";
+			}
+
+			script->time += ThreadTime() - start;
+			script->slices++;
+
+			// The state is published last so whoever sees it also sees the accounting and the error
+			script->state = state;
+
+			{
+				std::lock_guard lock(m_Mutex);
+
+				if (finished)
+					m_Active--;
+				else
+				{
+					// Give the other scripts their turn before this one continues
+					m_Queue.push_back(std::move(script));
+				}
+			}
+
+			if (finished)
+				m_Done.notify_all();
+			else
+				m_Ready.notify_one();
+		}
+	}
+}
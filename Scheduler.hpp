@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Interpreter.hpp"
+
+namespace def
+{
+	// A program submitted to the scheduler together with its accounting
+	struct Script
+	{
+		enum class State
+		{
+			Waiting,
+			Running,
+			Finished,
+			Failed
+		};
+
+		Script(std::shared_ptr<Interpreter> interpreter, std::shared_ptr<const Program> program);
+
+		std::shared_ptr<Interpreter> interpreter;
+		std::shared_ptr<const Program> program;
+
+		Continuation continuation;
+
+		std::atomic<State> state = State::Waiting;
+
+		// Valid only after the script has failed
+		std::string error;
+
+		// How many time slices the script got and how much CPU time its worker thread spent in them
+		// (time the thread was preempted isn't counted), safe to read once the state is Finished or Failed
+		size_t slices = 0;
+		std::chrono::nanoseconds time{ 0 };
+	};
+
+	// Interleaves many scripts over a fixed number of threads,
+	// every script runs for at most budget instructions before it goes to the back of the queue
+	class Scheduler
+	{
+	public:
+		Scheduler(size_t threads = std::thread::hardware_concurrency(), size_t budget = 10000);
+		~Scheduler();
+
+	public:
+		// An interpreter must not be shared between scripts that can run at the same time
+		std::shared_ptr<Script> Submit(std::shared_ptr<Interpreter> interpreter, std::shared_ptr<const Program> program);
+
+		// Blocks until all submitted scripts are finished or failed
+		void Wait();
+
+	private:
+		void Work();
+
+	private:
+		size_t m_Budget;
+
+		std::vector<std::thread> m_Threads;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Ready;
+		std::condition_variable m_Done;
+
+		std::deque<std::shared_ptr<Script>> m_Queue;
+
+		// Scripts that are submitted but not finished yet
+		size_t m_Active = 0;
+
+		bool m_Stop = false;
+
+	};
+}
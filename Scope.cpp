@@ -1,4 +1,6 @@
 #include "Scope.hpp"
+#include "Serialiser.hpp"
+#include "Memory.hpp"
 
 namespace def
 {
@@ -6,7 +8,7 @@ namespace def
 	{
 	}
 
-	void Scope::Assign(const std::string& name, const Object& value)
+	void Scope::Assign(const std::string& name, Object value)
 	{
 		if (!m_Values.contains(name))
 		{
@@ -15,7 +17,7 @@ namespace def
 			if (m_Parent)
 			{
 				// If we have the parent scope let's try to find the variable in it
-				return m_Parent->Assign(name, value);
+				return m_Parent->Assign(name, std::move(value));
 			}
 
 			// It occurs that we are in the global scope and we can't find variable here,
@@ -24,12 +26,88 @@ namespace def
 
 		// We found a variable in the current scope or it doesn't exist
 		// so let's assign a value to it
-		m_Values[name] = value;
+
+		if (m_Tracker)
+		{
+			// Charge only the difference with the previous value
+			const auto it = m_Values.find(name);
+
+			const size_t oldSize = it != m_Values.end() ? MemoryTracker::SizeOf(name, it->second) : 0;
+			const size_t newSize = MemoryTracker::SizeOf(name, value);
+
+			if (newSize > oldSize)
+				m_Tracker->Allocate(newSize - oldSize);
+			else
+				m_Tracker->Free(oldSize - newSize);
+		}
+
+		m_Values[name] = std::move(value);
+	}
+
+	const Object* Scope::Find(const std::string& name) const
+	{
+		const auto it = m_Values.find(name);
+
+		if (it != m_Values.end())
+			return &it->second;
+
+		return m_Parent ? m_Parent->Find(name) : nullptr;
+	}
+
+	void Scope::Remove(const std::string& name)
+	{
+		const auto it = m_Values.find(name);
+
+		if (it == m_Values.end())
+			return;
+
+		if (m_Tracker)
+			m_Tracker->Free(MemoryTracker::SizeOf(it->first, it->second));
+
+		m_Values.erase(it);
+	}
+
+	std::optional<Object> Scope::Take(const std::string& name)
+	{
+		const auto it = m_Values.find(name);
+
+		if (it == m_Values.end())
+			return std::nullopt;
+
+		if (m_Tracker)
+			m_Tracker->Free(MemoryTracker::SizeOf(it->first, it->second));
+
+		std::optional<Object> value = std::move(it->second);
+		m_Values.erase(it);
+
+		return value;
+	}
+
+	void Scope::Clear()
+	{
+		// Clearing walks all buckets even if there's nothing in them
+		if (m_Values.empty())
+			return;
+
+		if (m_Tracker)
+		{
+			for (const auto& [name, value] : m_Values)
+				m_Tracker->Free(MemoryTracker::SizeOf(name, value));
+		}
+
+		m_Values.clear();
+	}
+
+	void Scope::SetTracker(MemoryTracker* tracker)
+	{
+		m_Tracker = tracker;
 	}
 
 	std::optional<std::reference_wrapper<Object>> Scope::Get(const std::string& name)
 	{
-		if (!m_Values.contains(name))
+		const auto it = m_Values.find(name);
+
+		if (it == m_Values.end())
 		{
 			// We can't find a variable in the current scope
 
@@ -43,6 +121,93 @@ namespace def
 			return std::nullopt;
 		}
 
-		return m_Values[name];
+		return it->second;
+	}
+
+	static constexpr uint32_t SNAPSHOT_MAGIC = 0x53464544; // "DEFS"
+	static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+	bool Scope::Save(const std::string& path) const
+	{
+		StringTable strings;
+		BinaryWriter body;
+
+		for (const auto& [name, value] : m_Values)
+		{
+			body.Write(strings.Intern(name));
+			WriteObject(body, strings, value);
+		}
+
+		BinaryWriter writer;
+
+		writer.Write(SNAPSHOT_MAGIC);
+		writer.Write(SNAPSHOT_VERSION);
+		writer.Write(uint8_t(sizeof(long double)));
+		writer.Write(uint64_t(m_Values.size()));
+
+		strings.Write(writer);
+		writer.Append(body);
+
+		return writer.Save(path);
+	}
+
+	bool Scope::Load(const std::string& path)
+	{
+		BinaryReader reader;
+
+		if (!reader.Open(path))
+			return false;
+
+		try
+		{
+			if (reader.Read<uint32_t>() != SNAPSHOT_MAGIC || reader.Read<uint32_t>() != SNAPSHOT_VERSION)
+				return false;
+
+			if (reader.Read<uint8_t>() != sizeof(long double))
+				return false;
+
+			// Every variable has at least its name and the smallest object (a boolean)
+			const uint64_t count = reader.ReadCount<uint64_t>(sizeof(uint32_t) + 2 * sizeof(uint8_t));
+
+			StringTable strings;
+			strings.Read(reader);
+
+			// Allocate all buckets at once so the map is never rehashed while loading
+			std::unordered_map<std::string, Object> values;
+			values.reserve(count);
+
+			for (uint64_t i = 0; i < count; i++)
+			{
+				const auto name = strings.Get(reader.Read<uint32_t>());
+				values.emplace(name, ReadObject(reader, strings));
+			}
+
+			if (!reader.IsEnd())
+				return false;
+
+			if (m_Tracker)
+			{
+				size_t oldSize = 0, newSize = 0;
+
+				for (const auto& [name, value] : m_Values)
+					oldSize += MemoryTracker::SizeOf(name, value);
+
+				for (const auto& [name, value] : values)
+					newSize += MemoryTracker::SizeOf(name, value);
+
+				if (newSize > oldSize)
+					m_Tracker->Allocate(newSize - oldSize);
+				else
+					m_Tracker->Free(oldSize - newSize);
+			}
+
+			m_Values = std::move(values);
+			return true;
+		}
+		catch (const Exception&)
+		{
+			// The file is truncated or corrupted
+			return false;
+		}
 	}
 }
@@ -4,6 +4,7 @@
 #include <string>
 #include <variant>
 #include <optional>
+#include <vector>
 
 namespace def
 {
@@ -18,7 +19,18 @@ namespace def
 	struct String : Type<std::string> {};
 	struct Symbol : Type<std::string> {};
 
-	using Object = std::variant<Numeric, Boolean, String, Symbol>;
+	// Elements are stored contiguously so operators can process them in bulk
+	struct Array : Type<std::vector<double>> {};
+
+	struct Reference;
+
+	using Object = std::variant<Numeric, Boolean, String, Symbol, Array, Reference>;
+
+	// A constant or a name borrowed from a program, only the value stack holds it
+	// so literals and names are pushed without copying their strings
+	struct Reference : Type<const Object*> {};
+
+	class MemoryTracker;
 
 	class Scope
 	{
@@ -26,14 +38,38 @@ namespace def
 		Scope(Scope* parent = nullptr);
 
 	public:
-		void Assign(const std::string& name, const Object& value);
+		void Assign(const std::string& name, Object value);
+
+		// All variables of the scope are accounted by the tracker
+		void SetTracker(MemoryTracker* tracker);
 
 		std::optional<std::reference_wrapper<Object>> Get(const std::string& name);
 
+		// Read-only lookup that is safe to do from several threads at once
+		const Object* Find(const std::string& name) const;
+
+		// Removes the variable from the current scope if it's there
+		void Remove(const std::string& name);
+
+		// Removes the variable from the current scope and returns its value without copying it
+		std::optional<Object> Take(const std::string& name);
+
+		// Removes all variables of the current scope
+		void Clear();
+
+		// Writes variables of the current scope (not the parent ones) into a binary file
+		bool Save(const std::string& path) const;
+
+		// Replaces variables of the current scope with the ones from the file,
+		// the scope stays untouched if the file can't be read
+		bool Load(const std::string& path);
+
 	private:
 		Scope* m_Parent;
 
 		std::unordered_map<std::string, Object> m_Values;
 
+		MemoryTracker* m_Tracker = nullptr;
+
 	};
 }
@@ -0,0 +1,170 @@
+#include "Serialiser.hpp"
+
+#include <fstream>
+
+namespace def
+{
+	uint64_t Checksum(std::string_view data)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (unsigned char c : data)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	void BinaryWriter::WriteString(std::string_view value)
+	{
+		Write(uint32_t(value.size()));
+		m_Buffer.insert(m_Buffer.end(), value.begin(), value.end());
+	}
+
+	void BinaryWriter::Append(const BinaryWriter& other)
+	{
+		m_Buffer.insert(m_Buffer.end(), other.m_Buffer.begin(), other.m_Buffer.end());
+	}
+
+	bool BinaryWriter::Save(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+		if (!file.is_open())
+			return false;
+
+		file.write(m_Buffer.data(), m_Buffer.size());
+
+		return file.good();
+	}
+
+	bool BinaryReader::Open(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+		if (!file.is_open())
+			return false;
+
+		m_Buffer.resize(size_t(file.tellg()));
+		m_Cursor = 0;
+
+		file.seekg(0);
+		file.read(m_Buffer.data(), m_Buffer.size());
+
+		return file.good();
+	}
+
+	std::string_view BinaryReader::ReadString()
+	{
+		const uint32_t size = Read<uint32_t>();
+		return std::string_view(Take(size), size);
+	}
+
+	bool BinaryReader::IsEnd() const
+	{
+		return m_Cursor == m_Buffer.size();
+	}
+
+	const char* BinaryReader::Take(size_t size)
+	{
+		if (size > m_Buffer.size() - m_Cursor)
+			throw Exception("Unexpected end of the binary file");
+
+		const char* data = m_Buffer.data() + m_Cursor;
+		m_Cursor += size;
+
+		return data;
+	}
+
+	uint32_t StringTable::Intern(std::string_view value)
+	{
+		auto [it, inserted] = m_Indices.try_emplace(value, uint32_t(m_Strings.size()));
+
+		if (inserted)
+			m_Strings.push_back(value);
+
+		return it->second;
+	}
+
+	std::string_view StringTable::Get(uint32_t index) const
+	{
+		if (index >= m_Strings.size())
+			throw Exception("Invalid string index");
+
+		return m_Strings[index];
+	}
+
+	void StringTable::Write(BinaryWriter& writer) const
+	{
+		writer.Write(uint32_t(m_Strings.size()));
+
+		for (const auto& value : m_Strings)
+			writer.WriteString(value);
+	}
+
+	void StringTable::Read(BinaryReader& reader)
+	{
+		// Every string has at least its size
+		m_Strings.resize(reader.ReadCount(sizeof(uint32_t)));
+
+		for (auto& value : m_Strings)
+			value = reader.ReadString();
+	}
+
+	void WriteObject(BinaryWriter& writer, StringTable& strings, const Object& object)
+	{
+		// Borrowed values are written as the values themselves
+		if (const auto reference = std::get_if<Reference>(&object))
+			return WriteObject(writer, strings, *reference->value);
+
+		writer.Write(uint8_t(object.index()));
+
+		std::visit([&](const auto& value)
+			{
+				using T = std::decay_t<decltype(value)>;
+
+				if constexpr (std::is_same_v<T, Numeric>)
+					writer.Write(value.value);
+				else if constexpr (std::is_same_v<T, Boolean>)
+					writer.Write(uint8_t(value.value));
+				else if constexpr (std::is_same_v<T, Array>)
+				{
+					writer.Write(uint64_t(value.value.size()));
+
+					for (double element : value.value)
+						writer.Write(element);
+				}
+				else if constexpr (std::is_same_v<T, Reference>)
+					return;
+				else
+					writer.Write(strings.Intern(value.value));
+			}, object);
+	}
+
+	Object ReadObject(BinaryReader& reader, const StringTable& strings)
+	{
+		switch (reader.Read<uint8_t>())
+		{
+		case 0: return Numeric{ reader.Read<long double>() };
+		case 1: return Boolean{ reader.Read<uint8_t>() != 0 };
+		case 2: return String{ std::string(strings.Get(reader.Read<uint32_t>())) };
+		case 3: return Symbol{ std::string(strings.Get(reader.Read<uint32_t>())) };
+
+		case 4:
+		{
+			Array array;
+			array.value.resize(reader.ReadCount<uint64_t>(sizeof(double)));
+
+			for (double& element : array.value)
+				element = reader.Read<double>();
+
+			return array;
+		}
+
+		}
+
+		throw Exception("Invalid object type");
+	}
+}
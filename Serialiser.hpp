@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+#include "Exception.hpp"
+#include "Scope.hpp"
+
+namespace def
+{
+	// FNV-1a, used to detect stale files
+	uint64_t Checksum(std::string_view data);
+
+	class BinaryWriter
+	{
+	public:
+		BinaryWriter() = default;
+
+	public:
+		template <class T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			m_Buffer.insert(m_Buffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		void WriteString(std::string_view value);
+
+		void Append(const BinaryWriter& other);
+
+		// Returns false if the file can't be written
+		bool Save(const std::string& path) const;
+
+	private:
+		std::vector<char> m_Buffer;
+
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader() = default;
+
+	public:
+		// Reads the whole file at once, returns false if it can't be opened
+		bool Open(const std::string& path);
+
+		template <class T>
+		T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			T value;
+			std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+
+			return value;
+		}
+
+		// Reads a number of elements and checks that they fit into the rest of the file,
+		// so a corrupted count fails before the caller allocates memory for the elements
+		template <class T = uint32_t>
+		size_t ReadCount(size_t elementSize)
+		{
+			const T count = Read<T>();
+
+			if (count > (m_Buffer.size() - m_Cursor) / elementSize)
+				throw Exception("Invalid number of elements in the binary file");
+
+			return size_t(count);
+		}
+
+		// The view points into the reader's buffer so it doesn't copy
+		std::string_view ReadString();
+
+		bool IsEnd() const;
+
+	private:
+		const char* Take(size_t size);
+
+	private:
+		std::vector<char> m_Buffer;
+		size_t m_Cursor = 0;
+
+	};
+
+	// Every string is stored once and referenced by its index
+	class StringTable
+	{
+	public:
+		StringTable() = default;
+
+	public:
+		// The table only keeps a view so the string must outlive it
+		uint32_t Intern(std::string_view value);
+
+		std::string_view Get(uint32_t index) const;
+
+		void Write(BinaryWriter& writer) const;
+		void Read(BinaryReader& reader);
+
+	private:
+		std::vector<std::string_view> m_Strings;
+		std::unordered_map<std::string_view, uint32_t> m_Indices;
+
+	};
+
+	void WriteObject(BinaryWriter& writer, StringTable& strings, const Object& object);
+	Object ReadObject(BinaryReader& reader, const StringTable& strings);
+}
@@ -0,0 +1,96 @@
+#include "SharedScope.hpp"
+
+namespace def
+{
+	SharedScope::SharedScope(Snapshot snapshot) : m_Current(std::move(snapshot))
+	{
+	}
+
+	SharedScope::Snapshot SharedScope::Acquire() const
+	{
+		return m_Current.load(std::memory_order_acquire);
+	}
+
+	void SharedScope::Set(const std::string& name, const Object& value)
+	{
+		Submit({ name, value });
+	}
+
+	void SharedScope::Remove(const std::string& name)
+	{
+		Submit({ name, std::nullopt });
+	}
+
+	void SharedScope::Update(const std::function<void(Variables& variables)>& update)
+	{
+		std::lock_guard lock(m_Writer);
+
+		// Queued changes are left to their writers, they haven't returned so either order is valid
+		auto next = std::make_shared<Variables>(*m_Current.load(std::memory_order_acquire));
+		update(*next);
+
+		m_Current.store(std::move(next), std::memory_order_release);
+		m_Version.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void SharedScope::Submit(Change change)
+	{
+		uint64_t number;
+
+		{
+			std::lock_guard queue(m_Queue);
+
+			m_Pending.push_back(std::move(change));
+			number = ++m_Submitted;
+		}
+
+		std::lock_guard lock(m_Writer);
+
+		// The writer that held the lock may have published the change with its own
+		if (m_Published >= number)
+			return;
+
+		Publish();
+	}
+
+	void SharedScope::Publish()
+	{
+		// Readers may still hold the current version so it's never changed in place.
+		// The queue is taken after the copy so more changes share it
+		auto next = std::make_shared<Variables>(*m_Current.load(std::memory_order_acquire));
+
+		std::vector<Change> pending;
+		uint64_t last;
+
+		{
+			std::lock_guard queue(m_Queue);
+
+			pending.swap(m_Pending);
+			last = m_Submitted;
+		}
+
+		for (auto& change : pending)
+		{
+			if (change.value)
+				(*next)[change.name] = std::move(*change.value);
+			else
+				next->erase(change.name);
+		}
+
+		m_Current.store(std::move(next), std::memory_order_release);
+		m_Version.fetch_add(1, std::memory_order_relaxed);
+
+		m_Published = last;
+	}
+
+	uint64_t SharedScope::GetVersion() const
+	{
+		return m_Version.load(std::memory_order_relaxed);
+	}
+
+	const Object* SharedScope::Find(const Variables& variables, const std::string& name)
+	{
+		const auto it = variables.find(name);
+		return it != variables.end() ? &it->second : nullptr;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Scope.hpp"
+
+namespace def
+{
+	// Variables shared by many interpreters on different threads. Readers pin an immutable version
+	// and look names up without locks, writers copy the current version, change the copy and
+	// publish it atomically so readers never wait for them and never see a half-done update.
+	// Every version costs a copy of all variables, writes queued while another writer copies
+	// are published together with its own in a single copy
+	class SharedScope
+	{
+	public:
+		using Variables = std::unordered_map<std::string, Object>;
+		using Snapshot = std::shared_ptr<const Variables>;
+
+	public:
+		SharedScope(Snapshot snapshot = std::make_shared<const Variables>());
+
+	public:
+		// The version stays valid and unchanged for as long as it's held
+		Snapshot Acquire() const;
+
+		// The change is visible when the call returns, concurrent calls may share one version.
+		// Use Update to change many variables at once
+		void Set(const std::string& name, const Object& value);
+		void Remove(const std::string& name);
+		void Update(const std::function<void(Variables& variables)>& update);
+
+		// Number of versions published so far
+		uint64_t GetVersion() const;
+
+		static const Object* Find(const Variables& variables, const std::string& name);
+
+	private:
+		// A variable to assign or, without a value, to remove
+		struct Change
+		{
+			std::string name;
+			std::optional<Object> value;
+		};
+
+		void Submit(Change change);
+
+		// Copies the current version, applies all queued changes and publishes it,
+		// the writer lock must be held
+		void Publish();
+
+	private:
+		std::atomic<Snapshot> m_Current;
+
+		// Writers are serialised so no update is lost
+		std::mutex m_Writer;
+
+		std::atomic<uint64_t> m_Version = 0;
+
+		// Changes waiting for the next version, numbered in the order they were queued
+		std::mutex m_Queue;
+		std::vector<Change> m_Pending;
+		uint64_t m_Submitted = 0;
+
+		// Number of the last change published, guarded by the writer lock
+		uint64_t m_Published = 0;
+
+	};
+}
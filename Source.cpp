@@ -1,10 +1,222 @@
 ﻿#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 
 #include "Interpreter.hpp"
+#include "Serialiser.hpp"
+#include "Batch.hpp"
+#include "Parallel.hpp"
 
-int main()
+void PrintResult(const std::optional<def::Object>& result)
 {
+	if (result)
+	{
+		std::string text;
+		def::FormatResult(result, text);
+
+		std::cout << text << std::endl;
+	}
+}
+
+struct Options
+{
+	bool compileOnly = false;
+	bool profile = false;
+	bool optimise = true;
+	bool batch = false;
+	bool parallel = false;
+
+	// Number of lanes in the batch mode or threads in the parallel mode, 0 picks it from the number of cores
+	size_t workers = 0;
+
+	std::string outputPath;
+};
+
+// Every line of a script is a separate statement
+void CompileScript(const std::string& source, def::Program& program, bool optimise)
+{
+	def::Parser parser;
+	def::Compiler compiler;
+	compiler.SetOptimisation(optimise);
+
+	std::vector<def::Token> tokens;
+	std::istringstream stream(source);
+
+	std::string line;
+	size_t lineOffset = 0;
+
+	while (std::getline(stream, line))
+	{
+		if (!tokens.empty())
+			tokens.push_back(def::Token(def::Token::Type::Semicolon, ";"));
+
+		std::vector<def::Token> lineTokens;
+		parser.Tokenise(line, lineTokens);
+
+		for (auto& token : lineTokens)
+		{
+			token.offset += lineOffset;
+			tokens.push_back(token);
+		}
+
+		lineOffset += line.size() + 1;
+	}
+
+	compiler.Compile(tokens, program);
+}
+
+int RunFile(const std::string& path, const Options& options)
+{
+	const bool compileOnly = options.compileOnly;
+	std::string outputPath = options.outputPath;
+
+	def::Program program;
+
+	if (path.ends_with(".defc"))
+	{
+		if (compileOnly)
+		{
+			std::cerr << "The file is already compiled: " << path << std::endl;
+			return 1;
+		}
+
+		if (!program.Load(path))
+		{
+			std::cerr << "Can't load the compiled program: " << path << std::endl;
+			return 1;
+		}
+	}
+	else
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file.is_open())
+		{
+			std::cerr << "Can't open the file: " << path << std::endl;
+			return 1;
+		}
+
+		const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const uint64_t checksum = def::Checksum(source);
+
+		if (outputPath.empty())
+			outputPath = path + "c";
+
+		// Use the compiled file only if it was produced from the same source
+		// by the same version, otherwise fall back to compilation.
+		// Compiled files are always optimised
+		if (compileOnly || !options.optimise || !program.Load(outputPath, checksum))
+		{
+			program = def::Program();
+			CompileScript(source, program, options.optimise);
+		}
+
+		if (compileOnly)
+		{
+			if (!program.Save(outputPath, checksum))
+			{
+				std::cerr << "Can't write the compiled program: " << outputPath << std::endl;
+				return 1;
+			}
+
+			return 0;
+		}
+	}
+
+	def::Interpreter interpreter;
+
+	auto profiler = std::make_shared<def::Profiler>();
+
+	if (options.profile)
+		interpreter.SetProfiler(profiler);
+
+	if (options.parallel)
+	{
+		def::ParallelExecutor executor(options.workers > 0 ? options.workers : std::thread::hardware_concurrency());
+		PrintResult(executor.Execute(interpreter, program));
+	}
+	else
+		PrintResult(interpreter.Execute(program));
+
+	if (options.profile)
+		std::cerr << profiler->ToString();
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	std::string inputPath;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+
+		if (arg == "--compile-only")
+			options.compileOnly = true;
+		else if (arg == "--profile")
+			options.profile = true;
+		else if (arg == "--no-optimise")
+			options.optimise = false;
+		else if (arg == "--batch")
+			options.batch = true;
+		else if (arg == "--parallel")
+			options.parallel = true;
+		else if (arg == "--workers" && i + 1 < argc)
+			options.workers = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "-o" && i + 1 < argc)
+			options.outputPath = argv[++i];
+		else
+			inputPath = arg;
+	}
+
+	if (options.batch)
+	{
+		def::BatchRunner runner = options.workers > 0 ? def::BatchRunner(options.workers) : def::BatchRunner();
+
+		if (inputPath.empty())
+		{
+			std::ios::sync_with_stdio(false);
+			runner.Run(std::cin, std::cout);
+
+			return 0;
+		}
+
+		std::ifstream file(inputPath, std::ios::binary);
+
+		if (!file.is_open())
+		{
+			std::cerr << "Can't open the file: " << inputPath << std::endl;
+			return 1;
+		}
+
+		runner.Run(file, std::cout);
+		return 0;
+	}
+
+	if (!inputPath.empty())
+	{
+		try
+		{
+			return RunFile(inputPath, options);
+		}
+		catch (const def::Exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	if (options.compileOnly)
+	{
+		std::cerr << "Usage: --compile-only [-o output.defc] script" << std::endl;
+		return 1;
+	}
+
 	def::Parser parser;
+	def::Compiler compiler;
 	def::Interpreter interpreter;
 
 	std::string input;
@@ -23,20 +235,17 @@ int main()
 			for (const auto& token : tokens)
 				std::cout << token.ToString() << std::endl;
 
-			auto result = interpreter.Solve(tokens);
+			def::Program program;
+			compiler.Compile(tokens, program);
 
-			if (result)
-			{
-				std::visit([](const auto& arg)
-					{
-						if (std::is_same_v<decltype(arg), const def::Boolean&>)
-							std::cout << std::boolalpha;
+			std::cout << std::endl;
 
-						std::cout << arg.value << std::noboolalpha << std::endl;
-					}, result.value());
-			}
+			for (const auto& instruction : program.instructions)
+				std::cout << instruction.ToString() << std::endl;
+
+			PrintResult(interpreter.Execute(program));
 		}
-		catch (const def::ParserException& e)
+		catch (const def::Exception& e)
 		{
 			std::cerr << e.what() << std::endl;
 		}
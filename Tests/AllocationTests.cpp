@@ -0,0 +1,105 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../Interpreter.hpp"
+
+// Counts heap allocations made while expressions are executed: literals, names and variables
+// are borrowed so only new values (e.g. the result of a concatenation) may allocate.
+// Returns the number of expressions that allocated more than expected
+
+namespace
+{
+	size_t s_Allocations = 0;
+}
+
+void* operator new(size_t size)
+{
+	s_Allocations++;
+
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace
+{
+	size_t Count(def::Interpreter& interpreter, const std::string& source)
+	{
+		def::Parser parser;
+		def::Compiler compiler;
+		std::vector<def::Token> tokens;
+		def::Program program;
+
+		parser.Tokenise(source, tokens);
+		compiler.Compile(tokens, program);
+
+		// The first run warms up the inline caches of the program
+		interpreter.Execute(program);
+
+		const size_t before = s_Allocations;
+		interpreter.Execute(program);
+
+		return s_Allocations - before;
+	}
+}
+
+int main()
+{
+	const std::string text(1000, 'x');
+
+	def::Interpreter interpreter;
+	interpreter.SetVariable("s", def::String{ text });
+	interpreter.SetVariable("t", def::String{ text });
+	interpreter.SetVariable("a_rather_long_variable_name", def::String{ text });
+	interpreter.SetVariable("a_rather_long_number_name", def::Numeric{ 1 });
+
+	// Every execution reserves the value stack once
+	const size_t stack = Count(interpreter, "0");
+
+	struct Case
+	{
+		std::string source;
+		size_t expected;
+	};
+
+	const std::vector<Case> cases =
+	{
+		{ "s == t", 0 },
+		{ "s == \"" + text + "\"", 0 },
+		{ "a_rather_long_variable_name == s", 0 },
+		{ "if(s == t, 1, 2)", 0 },
+		{ "a_rather_long_variable_name", 1 },
+		{ "a_rather_long_number_name + 1", 0 },
+		{ "s + t", 1 },
+		{ "\"" + text + "\" + s", 1 },
+		{ "#(s + a_rather_long_variable_name)", 1 },
+	};
+
+	size_t failures = 0;
+
+	for (const auto& [source, expected] : cases)
+	{
+		const size_t allocations = Count(interpreter, source) - stack;
+		const bool failed = allocations > expected;
+
+		failures += failed;
+
+		std::cout << (failed ? "FAIL " : "ok   ") << allocations << " (expected " << expected << "): " << source.substr(0, 60) << std::endl;
+	}
+
+	return int(failures);
+}
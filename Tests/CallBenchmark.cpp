@@ -0,0 +1,70 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../Interpreter.hpp"
+
+// Measures the cost of a script function call with the recursive Fibonacci function,
+// fib(n) makes 2 * fib(n + 1) - 1 calls
+
+namespace
+{
+	def::Program Compile(const std::string& source)
+	{
+		def::Parser parser;
+		def::Compiler compiler;
+		std::vector<def::Token> tokens;
+		def::Program program;
+
+		parser.Tokenise(source, tokens);
+		compiler.Compile(tokens, program);
+
+		return program;
+	}
+
+	double Fibonacci(size_t n)
+	{
+		double a = 0, b = 1;
+
+		for (size_t i = 0; i < n; i++)
+			b = a + std::exchange(a, b);
+
+		return a;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t n = argc > 1 ? std::stoul(argv[1]) : 22;
+	const size_t repeats = 5;
+
+	def::Interpreter interpreter;
+	interpreter.Execute(Compile("fib(n) = if(n == 0, 0, if(n == 1, 1, fib(n - 1) + fib(n - 2)))"));
+
+	const auto program = Compile("fib(" + std::to_string(n) + ")");
+	const double calls = 2 * Fibonacci(n + 1) - 1;
+
+	double best = 0;
+
+	for (size_t i = 0; i < repeats; i++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const auto result = interpreter.Execute(program);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		if (!result || !std::holds_alternative<def::Numeric>(*result) || double(std::get<def::Numeric>(*result).value) != Fibonacci(n))
+		{
+			std::cout << "fib(" << n << ") returned a wrong result" << std::endl;
+			return 1;
+		}
+
+		if (i == 0 || elapsed.count() < best)
+			best = elapsed.count();
+	}
+
+	std::cout << "fib(" << n << "): " << best * 1000 << " ms, " << best * 1e9 / calls << " ns per call" << std::endl;
+
+	return 0;
+}
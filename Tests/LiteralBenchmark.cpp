@@ -0,0 +1,136 @@
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Parser.hpp"
+
+// Compares decoding of decimal literals by std::stold, which the compiler used before
+// tokens carried their values, with std::from_chars and with the decoder of the parser
+// on the same corpus. Returns the number of literals the decoder got wrong
+
+namespace
+{
+	std::vector<std::string> Generate(size_t count)
+	{
+		std::mt19937 random(40);
+		std::vector<std::string> corpus;
+
+		auto digits = [&](size_t length)
+			{
+				std::string text;
+
+				for (size_t i = 0; i < length; i++)
+					text += char('0' + random() % 10);
+
+				return text;
+			};
+
+		for (size_t i = 0; i < count; i++)
+		{
+			switch (random() % 5)
+			{
+			case 0: corpus.push_back(digits(1 + random() % 6)); break;
+			case 1: corpus.push_back(digits(1 + random() % 4) + "." + digits(1 + random() % 6)); break;
+			case 2: corpus.push_back(digits(1 + random() % 3) + "." + digits(1 + random() % 3) + "e" + (random() % 2 ? "-" : "") + std::to_string(random() % 20)); break;
+			case 3: corpus.push_back("0." + digits(1 + random() % 12)); break;
+			default: corpus.push_back(digits(10 + random() % 20) + "." + digits(1 + random() % 10)); break;
+			}
+		}
+
+		return corpus;
+	}
+
+	template <class F>
+	double Measure(const std::vector<std::string>& corpus, F&& decode, size_t repeats)
+	{
+		double best = 0;
+
+		for (size_t i = 0; i < repeats; i++)
+		{
+			long double sum = 0;
+
+			const auto start = std::chrono::steady_clock::now();
+
+			for (const auto& literal : corpus)
+				sum += decode(literal);
+
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			// Keeps the decoding from being optimised away
+			if (sum < 0)
+				std::cout << sum;
+
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+
+		// Literals per second
+		return corpus.size() / best;
+	}
+
+	long double FromChars(const std::string& literal)
+	{
+		long double value = 0;
+		std::from_chars(literal.data(), literal.data() + literal.size(), value);
+
+		return value;
+	}
+
+	long double Decode(const std::string& literal)
+	{
+		long double value = 0;
+
+		// Long literals fall back to from_chars as they do in the parser
+		if (!def::Parser::DecodeDecimal(literal, value))
+			value = FromChars(literal);
+
+		return value;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+	const size_t repeats = 5;
+
+	const auto corpus = Generate(count);
+
+	size_t mismatches = 0;
+
+	for (const auto& literal : corpus)
+	{
+		if (Decode(literal) != FromChars(literal) && mismatches++ < 5)
+			std::cout << "mismatch: " << literal << std::endl;
+	}
+
+	std::string source;
+
+	for (const auto& literal : corpus)
+		source += (source.empty() ? "" : ", ") + literal;
+
+	const double stold = Measure(corpus, [](const std::string& literal) { return std::stold(literal); }, repeats);
+	const double fromChars = Measure(corpus, FromChars, repeats);
+	const double decode = Measure(corpus, Decode, repeats);
+
+	// The whole corpus as one array literal, the parser decodes every element while tokenising
+	const double tokenise = Measure({ source }, [&](const std::string& text)
+		{
+			def::Parser parser;
+			std::vector<def::Token> tokens;
+
+			parser.Tokenise(text, tokens);
+
+			return tokens.back().number;
+		}, repeats) * count;
+
+	std::cout << count << " decimal literals, " << mismatches << " decoded differently from std::from_chars" << std::endl;
+	std::cout << "std::stold:                 " << stold / 1e6 << "M literals/s" << std::endl;
+	std::cout << "std::from_chars:            " << fromChars / 1e6 << "M literals/s" << std::endl;
+	std::cout << "Parser::DecodeDecimal:      " << decode / 1e6 << "M literals/s" << std::endl;
+	std::cout << "Parser::Tokenise:           " << tokenise / 1e6 << "M literals/s" << std::endl;
+
+	return int(mismatches);
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Engine.hpp"
+
+// Compares the cost of a native function call and of host variable reads with an inline operator
+// on programs of many identical statements, the bound string is 256 characters long
+
+namespace
+{
+	double Measure(def::Interpreter& interpreter, const std::string& statement, size_t statements, size_t repeats)
+	{
+		std::string source;
+
+		for (size_t i = 0; i < statements; i++)
+			source += (i ? "; " : "") + statement;
+
+		def::Parser parser;
+		def::Compiler compiler;
+		std::vector<def::Token> tokens;
+		def::Program program;
+
+		parser.Tokenise(source, tokens);
+		compiler.Compile(tokens, program);
+
+		double best = 0;
+
+		for (size_t i = 0; i < repeats; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			interpreter.Execute(program);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+
+		// Nanoseconds per statement
+		return best * 1e9 / statements;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t statements = argc > 1 ? std::stoul(argv[1]) : 10000;
+	const size_t repeats = 20;
+
+	def::Engine engine;
+	engine.Register("add", [](double a, double b) { return a + b; });
+	engine.Register("length", [](std::string_view text) { return text.size(); });
+
+	double number = 2.0;
+	std::string text(256, 'x');
+
+	def::Object object = def::String{ text };
+
+	engine.Bind("bound", number);
+	engine.Bind("text", text);
+	engine.Bind("object", object);
+
+	auto& interpreter = engine.GetInterpreter();
+	interpreter.SetVariable("x", def::Numeric{ 2.0 });
+	interpreter.SetVariable("s", def::String{ text });
+
+	const std::vector<std::pair<std::string, std::string>> cases =
+	{
+		{ "inline operator", "r = x + 1" },
+		{ "native function", "r = add(x, 1)" },
+		{ "bound number", "r = bound + 1" },
+		{ "native on a string", "r = length(s)" },
+		{ "bound string", "r = length(text)" },
+		{ "bound string object", "r = length(object)" },
+	};
+
+	for (const auto& [name, statement] : cases)
+		std::cout << name << " (" << statement << "): " << Measure(interpreter, statement, statements, repeats) << " ns" << std::endl;
+
+	return 0;
+}
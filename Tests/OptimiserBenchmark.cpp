@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Interpreter.hpp"
+
+// Compares the wall time of scripts compiled without and with superinstructions
+
+namespace
+{
+	def::Program Compile(const std::string& source, bool optimise)
+	{
+		def::Parser parser;
+		def::Compiler compiler;
+		std::vector<def::Token> tokens;
+		def::Program program;
+
+		compiler.SetOptimisation(optimise);
+
+		parser.Tokenise(source, tokens);
+		compiler.Compile(tokens, program);
+
+		return program;
+	}
+
+	double Measure(const std::string& source, bool optimise, size_t repeats)
+	{
+		const auto program = Compile(source, optimise);
+
+		double best = 0;
+
+		for (size_t i = 0; i < repeats; i++)
+		{
+			// Functions are defined by the script so every run starts from scratch
+			def::Interpreter interpreter;
+
+			const auto start = std::chrono::steady_clock::now();
+			interpreter.Execute(program);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t repeats = argc > 1 ? std::stoul(argv[1]) : 5;
+
+	std::string counter = "x = 0";
+
+	for (size_t i = 0; i < 10000; i++)
+		counter += "; x = x + 1";
+
+	const std::vector<std::pair<std::string, std::string>> cases =
+	{
+		{ "fib", "fib(n) = if(n == 0, 0, if(n == 1, 1, fib(n - 1) + fib(n - 2))); fib(20)" },
+		{ "countdown", "count(n) = if(n == 0, 0, count(n - 1)); count(100000)" },
+		{ "counter", counter },
+	};
+
+	for (const auto& [name, source] : cases)
+	{
+		const double before = Measure(source, false, repeats);
+		const double after = Measure(source, true, repeats);
+
+		std::cout << name << ": " << before * 1000 << " ms without superinstructions, " << after * 1000 << " ms with them, speedup " << before / after << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Parallel.hpp"
+
+// Measures how ParallelExecutor scales with the number of workers on a script of independent
+// statements: each one reads the same large array and writes its own variable
+
+namespace
+{
+	def::Program Compile(const std::string& source)
+	{
+		def::Parser parser;
+		def::Compiler compiler;
+		std::vector<def::Token> tokens;
+		def::Program program;
+
+		parser.Tokenise(source, tokens);
+		compiler.Compile(tokens, program);
+
+		return program;
+	}
+
+	template <class F>
+	double Measure(F&& execute, size_t repeats)
+	{
+		double best = 0;
+
+		for (size_t i = 0; i < repeats; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			execute();
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (i == 0 || elapsed.count() < best)
+				best = elapsed.count();
+		}
+
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t statements = argc > 1 ? std::stoul(argv[1]) : 64;
+	const size_t elements = argc > 2 ? std::stoul(argv[2]) : 200000;
+	const size_t repeats = 5;
+
+	std::string source;
+
+	for (size_t i = 0; i < statements; i++)
+		source += (i ? "; r" : "r") + std::to_string(i) + " = x * " + std::to_string(i + 1) + " + x * x - x / 3";
+
+	const auto program = Compile(source);
+	const def::Object input = def::Array{ std::vector<double>(elements, 1.5) };
+
+	def::Interpreter interpreter;
+	interpreter.SetVariable("x", input);
+
+	const double sequential = Measure([&]() { interpreter.Execute(program); }, repeats);
+
+	std::cout << statements << " statements over " << elements << " elements" << std::endl;
+	std::cout << "sequential: " << sequential * 1000 << " ms" << std::endl;
+
+	const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	for (size_t threads = 1; threads <= cores * 2; threads *= 2)
+	{
+		def::ParallelExecutor executor(threads);
+		const double parallel = Measure([&]() { executor.Execute(interpreter, program); }, repeats);
+
+		std::cout << threads << " workers: " << parallel * 1000 << " ms, speedup " << sequential / parallel << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../Parallel.hpp"
+#include "../Batch.hpp"
+
+// Runs random programs sequentially and with ParallelExecutor and compares the results,
+// the reported errors and every variable afterwards. Returns the number of mismatches
+
+namespace
+{
+	const std::vector<std::string> s_Names = { "a", "b", "c", "d", "e", "f", "g", "h" };
+
+	std::string Describe(const std::optional<def::Object>& result)
+	{
+		if (!result)
+			return "(none)";
+
+		std::string text;
+		def::FormatResult(result, text);
+
+		return std::to_string(result->index()) + ":" + text;
+	}
+
+	// Statements share a few variables so both dependent and independent ones are generated
+	std::string Generate(std::mt19937& random)
+	{
+		auto name = [&]() { return s_Names[random() % s_Names.size()]; };
+		auto number = [&](unsigned range) { return std::to_string(random() % range); };
+
+		auto expression = [&]() -> std::string
+			{
+				switch (random() % 10)
+				{
+				case 0: return number(10);
+				case 1: return name() + " + " + number(5);
+				case 2: return name() + " * " + name();
+				case 3: return "if(" + name() + " == " + number(3) + ", " + name() + ", " + number(4) + ")";
+				case 4: return number(9) + " - " + name();
+				case 5: return "[1, 2] * " + name();
+				case 6: return "sq(" + name() + ")";
+				case 7: return name() + " - " + name() + " / 2";
+				case 8: return "\"ab\" + " + name();
+				default: return "(" + name() + " = " + number(7) + ") + 1";
+				}
+			};
+
+		std::string source;
+		const size_t count = 2 + random() % 25;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i)
+				source += "; ";
+
+			switch (random() % 12)
+			{
+			case 0: source += "sq(x) = x * x"; break;
+			case 1: { const auto variable = name(); source += variable + " = " + variable + " + 1"; } break;
+			case 2: source += expression(); break;
+			default: source += name() + " = " + expression(); break;
+			}
+		}
+
+		return source;
+	}
+
+	// Strings grow quickly so a small limit is exceeded in the middle of the program
+	std::string GenerateDoubling(std::mt19937& random)
+	{
+		std::string source = "s = \"x\"";
+
+		for (size_t i = 0; i < 12; i++)
+		{
+			source += "; s = s + s";
+
+			if (random() % 2)
+				source += "; " + s_Names[random() % s_Names.size()] + " = " + std::to_string(i);
+		}
+
+		return source;
+	}
+
+	std::string Run(const std::function<std::optional<def::Object>()>& execute, const def::Interpreter& interpreter)
+	{
+		std::string state;
+
+		try
+		{
+			state = Describe(execute());
+		}
+		catch (const def::Exception& e)
+		{
+			state = std::string("error ") + e.what();
+		}
+
+		for (const auto& name : s_Names)
+		{
+			const auto value = interpreter.GetVariable(name);
+			state += " " + name + "=" + (value ? Describe(*value) : "-");
+		}
+
+		return state;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t rounds = argc > 1 ? std::stoul(argv[1]) : 3000;
+
+	std::mt19937 random(7);
+	def::ParallelExecutor executor(4);
+
+	size_t mismatches = 0;
+
+	for (size_t round = 0; round < rounds; round++)
+	{
+		const bool limited = round % 10 == 0;
+		const std::string source = limited ? GenerateDoubling(random) : Generate(random);
+
+		def::Program program;
+
+		try
+		{
+			def::Parser parser;
+			def::Compiler compiler;
+			std::vector<def::Token> tokens;
+
+			parser.Tokenise(source, tokens);
+			compiler.Compile(tokens, program);
+		}
+		catch (const def::Exception&)
+		{
+			continue;
+		}
+
+		def::Interpreter sequential, parallel;
+
+		for (const auto& name : s_Names)
+		{
+			const def::Object value = def::Numeric{ (long double)(random() % 3) };
+
+			sequential.SetVariable(name, value);
+			parallel.SetVariable(name, value);
+		}
+
+		if (limited)
+		{
+			const size_t limit = 2048 + random() % 4096;
+
+			sequential.SetMemoryLimit(limit);
+			parallel.SetMemoryLimit(limit);
+		}
+
+		const auto expected = Run([&]() { return sequential.Execute(program); }, sequential);
+		const auto actual = Run([&]() { return executor.Execute(parallel, program); }, parallel);
+
+		if (expected != actual && mismatches++ < 5)
+			std::cout << source << "\n  sequential: " << expected << "\n  parallel:   " << actual << std::endl;
+	}
+
+	std::cout << rounds << " programs, " << mismatches << " mismatches" << std::endl;
+
+	return mismatches != 0;
+}
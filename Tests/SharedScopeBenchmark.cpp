@@ -0,0 +1,119 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../SharedScope.hpp"
+
+// Measures lookups per second of readers of a SharedScope while writers keep setting variables,
+// and how many sets share one published version. Returns the number of lost writes
+
+namespace
+{
+	struct Result
+	{
+		double reads;
+		double sets;
+		double versions;
+		size_t lost;
+	};
+
+	Result Measure(size_t variables, size_t readers, size_t writers, double seconds)
+	{
+		def::SharedScope scope;
+		std::vector<std::string> names;
+
+		scope.Update([&](def::SharedScope::Variables& values)
+			{
+				for (size_t i = 0; i < variables; i++)
+				{
+					names.push_back("v" + std::to_string(i));
+					values[names.back()] = def::Numeric{ (long double)i };
+				}
+			});
+
+		std::atomic<bool> stop = false;
+		std::atomic<size_t> reads = 0, sets = 0;
+		std::vector<size_t> written(writers, 0);
+		std::vector<std::thread> threads;
+
+		const uint64_t version = scope.GetVersion();
+
+		for (size_t reader = 0; reader < readers; reader++)
+		{
+			threads.emplace_back([&, reader]()
+				{
+					size_t count = 0;
+
+					for (size_t i = reader; !stop.load(std::memory_order_relaxed); i++, count++)
+					{
+						const auto snapshot = scope.Acquire();
+
+						if (!def::SharedScope::Find(*snapshot, names[i % names.size()]))
+							std::cout << "missing " << names[i % names.size()] << std::endl;
+					}
+
+					reads += count;
+				});
+		}
+
+		// Every writer counts up its own variable so a lost write leaves a smaller value
+		for (size_t writer = 0; writer < writers; writer++)
+		{
+			threads.emplace_back([&, writer]()
+				{
+					const std::string name = "w" + std::to_string(writer);
+
+					while (!stop.load(std::memory_order_relaxed))
+						scope.Set(name, def::Numeric{ (long double)++written[writer] });
+
+					sets += written[writer];
+				});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		stop = true;
+
+		for (auto& thread : threads)
+			thread.join();
+
+		size_t lost = 0;
+		const auto snapshot = scope.Acquire();
+
+		for (size_t writer = 0; writer < writers; writer++)
+		{
+			const auto value = def::SharedScope::Find(*snapshot, "w" + std::to_string(writer));
+			lost += !value || std::get<def::Numeric>(*value).value != written[writer];
+		}
+
+		return { reads / seconds, sets / seconds, double(scope.GetVersion() - version), lost };
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t variables = argc > 1 ? std::stoul(argv[1]) : 1000;
+	const size_t readers = argc > 2 ? std::stoul(argv[2]) : 2;
+	const double seconds = 0.5;
+
+	size_t lost = 0;
+
+	std::cout << variables << " variables, " << readers << " readers" << std::endl;
+
+	for (size_t writers : { 0, 1, 2, 4 })
+	{
+		const auto result = Measure(variables, readers, writers, seconds);
+		lost += result.lost;
+
+		std::cout << writers << " writers: " << result.reads / 1e6 << "M reads/s, " << result.sets / 1e3 << "k sets/s";
+
+		if (writers)
+			std::cout << ", " << result.sets * seconds / result.versions << " sets per version";
+
+		std::cout << std::endl;
+	}
+
+	return int(lost);
+}
@@ -15,6 +15,7 @@ namespace def
 		{
 		case Type::Literal_NumericBase16:  tag = "[Literal, Numeric 16 ] "; break;
 		case Type::Literal_NumericBase10:  tag = "[Literal, Numeric 10 ] "; break;
+		case Type::Literal_NumericBase8:   tag = "[Literal, Numeric 8  ] "; break;
 		case Type::Literal_NumericBase2:   tag = "[Literal, Numeric 2  ] "; break;
 		case Type::Literal_String:         tag = "[Literal, String     ] "; break;
 		case Type::Keyword:			       tag = "[Keyword             ] "; break;
@@ -13,6 +13,7 @@ namespace def
 			Literal_NumericBaseUnknown,
 			Literal_NumericBase16,
 			Literal_NumericBase10,
+			Literal_NumericBase8,
 			Literal_NumericBase2,
 			Literal_String,
 			Literal_Boolean,
@@ -35,5 +36,11 @@ namespace def
 		Type type = Type::None;
 		std::string value;
 
+		// Numeric literals are decoded by the parser, the value keeps only their digits
+		long double number = 0;
+
+		// Position of the first character of the token in the source
+		size_t offset = 0;
+
 	};
 }